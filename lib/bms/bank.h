@@ -0,0 +1,229 @@
+//
+// Battery packs polled as one bank
+//
+// Packs on their own serial ports are polled at the same time, so a cycle takes as long as the slowest pack rather
+// than the sum of all packs. Packs sharing a port (an RS-485 bus) take turns, the selector switches the bus to the
+// next pack before its queries go out. Nothing blocks either way, update() only moves on what has arrived. The start
+// of each cycle rotates, so on a shared bus no pack is always the one with the oldest data.
+//
+
+#ifndef POWER_CONTROLLER_EVERY_BANK_H
+#define POWER_CONTROLLER_EVERY_BANK_H
+
+#include <bms.h>
+
+typedef void (*PackSelector)(uint8_t pack); // switches a shared port to the pack
+
+template<typename Pack, uint8_t Packs>
+class PackBank {
+    static_assert(Packs > 0 && Packs <= 8, "the pack states are kept in bytes");
+
+public:
+    void begin(uint8_t pack, Stream *port, uint16_t timeout = 2000) {
+        ports[pack] = port;
+        packs[pack].begin(port, timeout);
+    }
+
+    void setSelector(PackSelector packSelector) {
+        selector = packSelector;
+    }
+
+    // starts a cycle on every pack, ignored while the previous cycle is still running
+    void poll() {
+        if (isBusy()) {
+            return;
+        }
+        first = first + 1 < Packs ? first + 1 : 0;
+        for (uint8_t i = 0; i < Packs; i++) {
+            if (ports[i] != nullptr) {
+                waiting |= 1u << i;
+            }
+        }
+        startPacks();
+    }
+
+    // call on every loop pass, returns true once when every pack of the cycle has answered or timed out
+    bool update() {
+        uint8_t wasOnline = online;
+        for (uint8_t i = 0; i < Packs; i++) {
+            // on a shared port the bytes belong to the pack that is being polled
+            if (ports[i] != nullptr && ((polling & 1u << i) || !isPortBusy(ports[i]))) {
+                if (packs[i].update()) {
+                    online |= 1u << i;
+                } else if ((polling & 1u << i) && !packs[i].isBusy()) {
+                    online &= ~(1u << i); // timed out or garbled
+                }
+                if (!packs[i].isBusy()) {
+                    polling &= ~(1u << i);
+                }
+            }
+        }
+        if (online != wasOnline) {
+            transitions++;
+        }
+        if (waiting != 0) {
+            startPacks();
+        }
+        if (cycling && !isBusy()) {
+            cycling = false;
+            return true;
+        }
+        return false;
+    }
+
+    bool isBusy() const {
+        return (waiting | polling) != 0;
+    }
+
+    static constexpr uint8_t size() {
+        return Packs;
+    }
+
+    Pack &operator[](uint8_t pack) {
+        return packs[pack];
+    }
+
+    const Pack &operator[](uint8_t pack) const {
+        return packs[pack];
+    }
+
+    // a pack is online from a completed cycle until a cycle fails
+    bool isOnline(uint8_t pack) const {
+        return online & 1u << pack;
+    }
+
+    // false while the aggregates read 0 for want of data rather than because the bank is at rest
+    bool anyOnline() const {
+        return online != 0;
+    }
+
+    // a pack going offline or coming back changes the aggregates without a new cycle of its own
+    uint32_t generation() const {
+        uint32_t sum = transitions;
+        for (uint8_t i = 0; i < Packs; i++) {
+            sum += packs[i].generation();
+        }
+        return sum;
+    }
+
+    // the aggregates only cover the packs that are online, a bank with none online reads 0
+
+    float current() const {
+        float sum = 0;
+        for (uint8_t i = 0; i < Packs; i++) {
+            sum += isOnline(i) ? packs[i].current : 0;
+        }
+        return sum;
+    }
+
+    // the packs are in parallel, so their voltages differ by the wiring only
+    float totalVoltage() const {
+        float sum = 0;
+        uint8_t count = 0;
+        for (uint8_t i = 0; i < Packs; i++) {
+            if (isOnline(i)) {
+                sum += packs[i].totalVoltage;
+                count++;
+            }
+        }
+        return count != 0 ? sum / count : 0;
+    }
+
+    uint8_t stateOfCharge() const {
+        uint8_t lowest = 0;
+        bool found = false;
+        for (uint8_t i = 0; i < Packs; i++) {
+            if (isOnline(i) && (!found || packs[i].stateOfCharge < lowest)) {
+                lowest = packs[i].stateOfCharge;
+                found = true;
+            }
+        }
+        return lowest;
+    }
+
+    // lowest cell voltage of the bank and where it is
+    float worstCellVoltage(uint8_t &pack, uint8_t &cell) const {
+        float lowest = 0;
+        bool found = false;
+        pack = 0;
+        cell = 0;
+        for (uint8_t i = 0; i < Packs; i++) {
+            if (!isOnline(i)) {
+                continue;
+            }
+            uint8_t cells = min(packs[i].numCells, Pack::cellCount());
+            for (uint8_t j = 0; j < cells; j++) {
+                if (!found || packs[i].cellVoltages[j] < lowest) {
+                    lowest = packs[i].cellVoltages[j];
+                    found = true;
+                    pack = i;
+                    cell = j;
+                }
+            }
+        }
+        return lowest;
+    }
+
+    ProtectionStatus protectionStatus() const {
+        uint16_t bits = 0;
+        for (uint8_t i = 0; i < Packs; i++) {
+            bits |= isOnline(i) ? packs[i].protectionStatus.bits : 0;
+        }
+        return bits;
+    }
+
+    void clearFaultCounts() {
+        for (uint8_t i = 0; i < Packs; i++) {
+            packs[i].clearFaultCounts();
+        }
+    }
+
+private:
+    Pack packs[Packs];
+    Stream *ports[Packs]{};
+    PackSelector selector = nullptr;
+    uint8_t waiting = 0; // bit n is set while pack n waits for its port
+    uint8_t polling = 0; // bit n is set while pack n is in a cycle
+    uint8_t online = 0; // bit n is set while pack n answers
+    uint32_t transitions = 0; // changes of online
+    uint8_t first = Packs - 1; // pack that started the current cycle
+    bool cycling = false;
+
+    bool isPortBusy(const Stream *port) const {
+        for (uint8_t i = 0; i < Packs; i++) {
+            if ((polling & 1u << i) && ports[i] == port) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool isPortShared(uint8_t pack) const {
+        for (uint8_t i = 0; i < Packs; i++) {
+            if (i != pack && ports[i] == ports[pack]) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void startPacks() {
+        for (uint8_t k = 0; k < Packs; k++) {
+            uint8_t i = first + k < Packs ? first + k : first + k - Packs;
+            if (!(waiting & 1u << i) || isPortBusy(ports[i])) {
+                continue;
+            }
+            if (selector != nullptr && isPortShared(i)) {
+                selector(i);
+            }
+            waiting &= ~(1u << i);
+            packs[i].poll();
+            if (packs[i].isBusy()) {
+                polling |= 1u << i;
+                cycling = true;
+            }
+        }
+    }
+};
+
+#endif //POWER_CONTROLLER_EVERY_BANK_H
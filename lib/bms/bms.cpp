@@ -32,11 +32,59 @@ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 POSSIBILITY OF SUCH DAMAGE.
 */
 
-#ifdef ARDUINO
+#if defined(ARDUINO) || defined(NATIVE_HAL)
 
 #include <bms.h>
 
-BMS::BMS() {
+static const char faultCellOvervoltage[] PROGMEM = "Single Cell Over-Voltage";
+static const char faultCellUndervoltage[] PROGMEM = "Single Cell Under-Voltage";
+static const char faultPackOvervoltage[] PROGMEM = "Whole Pack Over-Voltage";
+static const char faultPackUndervoltage[] PROGMEM = "Whole Pack Under-Voltage";
+static const char faultChargeOverTemperature[] PROGMEM = "Charging Over Temperature";
+static const char faultChargeLowTemperature[] PROGMEM = "Charging Low Temperature";
+static const char faultDischargeOverTemperature[] PROGMEM = "Discharge Over Temperature";
+static const char faultDischargeLowTemperature[] PROGMEM = "Discharge Low Temperature";
+static const char faultChargeOvercurrent[] PROGMEM = "Charging Over-Current";
+static const char faultDischargeOvercurrent[] PROGMEM = "Discharge Over-Current";
+static const char faultShortCircuit[] PROGMEM = "Short Circuit";
+static const char faultFrontEndIcError[] PROGMEM = "Front End Detection Ic Error";
+static const char faultSoftwareLockMos[] PROGMEM = "Software Lock Mos";
+
+// indexed by Fault
+static const char *const faultNames[NUM_FAULTS] PROGMEM = {
+        faultCellOvervoltage, faultCellUndervoltage, faultPackOvervoltage, faultPackUndervoltage,
+        faultChargeOverTemperature, faultChargeLowTemperature, faultDischargeOverTemperature,
+        faultDischargeLowTemperature, faultChargeOvercurrent, faultDischargeOvercurrent, faultShortCircuit,
+        faultFrontEndIcError, faultSoftwareLockMos
+};
+
+const char *faultName(uint8_t fault) {
+    return (const char *) pgm_read_ptr(&faultNames[fault]);
+}
+
+// JBD basic info response, offsets from the start of the frame
+const BasicInfoLayout jbdBasicInfoLayout PROGMEM = {{
+        {4, 2 | FIELD_DECIMALS(2)}, // total voltage, 0.01 V
+        {6, 2 | FIELD_SIGNED | FIELD_DECIMALS(2)}, // current, 0.01 A, negative while discharging
+        {8, 2 | FIELD_DECIMALS(2)}, // balance capacity, 0.01 Ah
+        {10, 2 | FIELD_DECIMALS(2)}, // rate capacity, 0.01 Ah
+        {12, 2}, // cycle count
+        {14, 2}, // production date
+        {16, 2}, // balance status, cells 1-16
+        {18, 2}, // balance status, cells 17-32
+        {20, 2}, // protection status
+        {22, 1}, // software version
+        {23, 1}, // state of charge, %
+        {24, 1}, // FET status
+        {25, 1}, // number of cells
+        {26, 1}  // number of temperature sensors
+}, {27, 2 | FIELD_DECIMALS(1)}};
+
+// indexed by the decimals of a FrameField
+static const float decimalScales[] PROGMEM = {1.0f, 0.1f, 0.01f, 0.001f};
+
+BmsCore::BmsCore(uint8_t *rxBuffer, uint8_t rxCapacity, FrameParser parseArrays)
+        : rxBuffer(rxBuffer), rxCapacity(rxCapacity), parseArrays(parseArrays) {
     totalVoltage = 0;
     current = 0;
     balanceCapacity = 0;
@@ -50,52 +98,118 @@ BMS::BMS() {
     isChargeFetEnabled = false;
     numCells = 0;
     numTemperatureSensors = 0;
-    for (uint8_t i; i < NUM_TEMP_SENSORS; i++) {
-        temperatures[i] = 0;
-    }
-    for (uint8_t i; i < NUM_CELLS; i++) {
-        cellVoltages[i] = 0;
-    }
-    name = String("");
+    setBasicInfoLayout(&jbdBasicInfoLayout);
+    name[0] = 0;
 
     comError = false;
+    dataGeneration = 0;
     isEnabled = false;
     balanceStatus = 0;
-    lastProtectionStatus = 0;
+
+    rxIndex = 0;
+    rxExpected = 0;
+    rxSum = 0;
+    rxChecksum = 0;
+    pollState = IDLE;
+    pipelined = true;
+    unsentQueries = 0;
+    awaitedResponses = 0;
+    nameQueries = 0;
+    responseTimeout = 0;
+    requestTime = 0;
 }
 
-void BMS::begin(Stream *port, uint16_t timeout) {
+void BmsCore::begin(Stream *port, uint16_t timeout) {
 #if BMS_OPTION_DEBUG
     Serial.println("OverkillSolarBMS Begin!");
 #endif
     serial = port;
-    serial->setTimeout(timeout);
+    responseTimeout = timeout;
+    rxIndex = 0;
+    pollState = IDLE;
     isEnabled = true;
 }
 
-void BMS::end() {
+void BmsCore::setPipelined(bool enabled) {
+    pipelined = enabled;
+}
+
+void BmsCore::setBasicInfoLayout(const BasicInfoLayout *layout) {
+    basicInfoLayout = layout;
+    basicInfoEnd = 0;
+    for (uint8_t i = 0; i < NUM_BASIC_INFO_VALUES; i++) {
+        FrameField field = basicInfoField(i);
+        basicInfoEnd = max(basicInfoEnd, field.offset + (field.format & FIELD_WIDTH_MASK));
+    }
+}
+
+FrameField BmsCore::basicInfoField(uint8_t value) const {
+    FrameField field;
+    memcpy_P(&field, &basicInfoLayout->fields[value], sizeof(field));
+    return field;
+}
+
+void BmsCore::end() {
     isEnabled = false;
+    pollState = IDLE;
+}
+
+void BmsCore::poll() {
+    if (isEnabled && !isBusy()) {
+        // the name never changes, it is only asked for until the first answer and a few times at most
+        bool askName = name[0] == 0 && nameQueries < NAME_QUERY_ATTEMPTS;
+        nameQueries += askName ? 1 : 0;
+        unsentQueries = QUERY_REQUIRED | (askName ? QUERY_NAME : 0);
+        awaitedResponses = 0;
+        rxIndex = 0;
+        pollState = WAITING;
+        sendQueries();
+    }
 }
 
-void BMS::poll() {
-    if (isEnabled) {
-        queryBasicInfo();
-        minVoltage24 = totalVoltage < minVoltage24 ? totalVoltage : minVoltage24;
-        maxVoltage24 = totalVoltage > maxVoltage24 ? totalVoltage : maxVoltage24;
-        maxCharge24 = current > maxCharge24 ? current : maxCharge24;
-        maxDischarge24 = current < -maxDischarge24 ? -current : maxDischarge24;
-        queryCellVoltages();
-        if(name.equals("")){
-            queryBmsName();
+bool BmsCore::update() {
+    if (!isEnabled) {
+        return false;
+    }
+
+    while (serial->available() > 0) {
+        receiveByte((uint8_t) serial->read());
+    }
+
+    if (isBusy() && millis() - requestTime > responseTimeout) {
+#if BMS_OPTION_DEBUG
+        Serial.println("BMS response timeout");
+#endif
+        rxIndex = 0;
+        if (unsentQueries == 0 && !(awaitedResponses & QUERY_REQUIRED)) {
+            // only the name is missing, the data of the cycle is complete
+            completeCycle();
+        } else {
+            comError = true;
+            pollState = IDLE;
         }
     }
+
+    if (pollState == DONE) {
+        pollState = IDLE;
+        return true;
+    }
+    return false;
 }
 
-bool BMS::hasComError() const {
+bool BmsCore::hasComError() const {
     return comError;
 }
 
-bool BMS::isBalancing(uint8_t cellNumber) const {
+bool BmsCore::isBusy() const {
+    return pollState != IDLE && pollState != DONE;
+}
+
+uint32_t BmsCore::generation() const {
+    return dataGeneration;
+}
+
+bool BmsCore::isBalancing(uint8_t cellNumber) const {
     if (cellNumber <= numCells) {
         return (balanceStatus >> cellNumber) & 1u;
     }
@@ -104,23 +218,12 @@ bool BMS::isBalancing(uint8_t cellNumber) const {
     }
 }
 
-void BMS::clearFaultCounts() {
-    faultCounts.singleCellOvervoltageProtection    = 0;
-    faultCounts.singleCellUndervoltageProtection   = 0;
-    faultCounts.wholePackOvervoltageProtection     = 0;
-    faultCounts.wholePackUndervoltageProtection    = 0;
-    faultCounts.chargingOverTemperatureProtection  = 0;
-    faultCounts.chargingLowTemperatureProtection   = 0;
-    faultCounts.dischargeOverTemperatureProtection = 0;
-    faultCounts.dischargeLowTemperatureProtection  = 0;
-    faultCounts.chargingOvercurrentProtection      = 0;
-    faultCounts.dischargeOvercurrentProtection     = 0;
-    faultCounts.shortCircuitProtection             = 0;
-    faultCounts.frontEndDetectionIcError           = 0;
-    faultCounts.softwareLockMos                    = 0;
+void BmsCore::clearFaultCounts() {
+    memset(faultCounts, 0, sizeof(faultCounts));
+    dataGeneration++;
 }
 
-void BMS::setMosfetControl(bool charge, bool discharge) {
+void BmsCore::setMosfetControl(bool charge, bool discharge) {
 #if BMS_OPTION_DEBUG
     Serial.println("Query 0xE1 MOSFET Control");
 #endif
@@ -131,11 +234,11 @@ void BMS::setMosfetControl(bool charge, bool discharge) {
         serial->write(data, sizeof(data));
     }
 
-    uint8_t buffer[RX_BUFFER_SIZE] {0};
+    uint8_t buffer[FRAME_OVERHEAD] {0};
     comError = validateResponse(buffer, CMD_CTL_MOSFET, 0);
 }
 
-void BMS::calculateMosfetCommandString(uint8_t * commandString, bool charge, bool discharge) {
+void BmsCore::calculateMosfetCommandString(uint8_t * commandString, bool charge, bool discharge) {
     uint8_t xxByte = 0b11;
     xxByte &= charge ? 0b10u : 0b11u;
     xxByte &= discharge ? 0b01u : 0b11u;
@@ -147,7 +250,7 @@ void BMS::calculateMosfetCommandString(uint8_t * commandString, bool charge, boo
 }
 
 #if BMS_OPTION_DEBUG
-void BMS::debug() {
+void BmsCore::debug() {
     Serial.println("==============================================");
     Serial.print("Voltage:           ");
     Serial.print(totalVoltage, 3);
@@ -176,32 +279,13 @@ void BMS::debug() {
     Serial.println(productionDate.year, DEC);
 
     Serial.println("Protection Status: ");
-    Serial.print("  softwareLockMos:                    ");
-    Serial.println(protectionStatus.softwareLockMos, DEC);
-    Serial.print("  frontEndDetectionIcError:         ");
-    Serial.println(protectionStatus.frontEndDetectionIcError, DEC);
-    Serial.print("  shortCircuitProtection:             ");
-    Serial.println(protectionStatus.shortCircuitProtection, DEC);
-    Serial.print("  dischargeOvercurrentProtection:     ");
-    Serial.println(protectionStatus.dischargeOvercurrentProtection, DEC);
-    Serial.print("  chargingOvercurrentProtection:      ");
-    Serial.println(protectionStatus.chargingOvercurrentProtection, DEC);
-    Serial.print("  dischargeLowTemperatureProtection: ");
-    Serial.println(protectionStatus.dischargeLowTemperatureProtection, DEC);
-    Serial.print("  dischargeOverTemperatureProtection:");
-    Serial.println(protectionStatus.dischargeOverTemperatureProtection, DEC);
-    Serial.print("  chargingLowTemperatureProtection:  ");
-    Serial.println(protectionStatus.chargingLowTemperatureProtection, DEC);
-    Serial.print("  chargingOverTemperatureProtection: ");
-    Serial.println(protectionStatus.chargingOverTemperatureProtection, DEC);
-    Serial.print("  wholePackUndervoltageProtection:   ");
-    Serial.println(protectionStatus.wholePackUndervoltageProtection, DEC);
-    Serial.print("  wholePackOvervoltageProtection:    ");
-    Serial.println(protectionStatus.wholePackOvervoltageProtection, DEC);
-    Serial.print("  singleCellUndervoltageProtection:  ");
-    Serial.println(protectionStatus.singleCellUndervoltageProtection, DEC);
-    Serial.print("  singleCellOvervoltageProtection:   ");
-    Serial.println(protectionStatus.singleCellOvervoltageProtection, DEC);
+    char faultText[FAULT_NAME_SIZE];
+    for (uint8_t i = 0; i < NUM_FAULTS; i++) {
+        Serial.print("  ");
+        Serial.print(strcpy_P(faultText, faultName(i)));
+        Serial.print(": ");
+        Serial.println(protectionStatus.isSet(i), DEC);
+    }
 
     Serial.print("Software version:  ");
     Serial.print(softwareVersion.major, DEC);
@@ -224,137 +308,106 @@ void BMS::debug() {
     Serial.print("# of temp sensors: ");
     Serial.println(numTemperatureSensors, DEC);
 
-    Serial.println("Temperatures:");
-    for (int i=0; i < min(NUM_TEMP_SENSORS, numTemperatureSensors); i++) {
-        Serial.print("  ");
-        Serial.print(temperatures[i], 1);
-        Serial.println(" deg C");
-    }
-
-    Serial.println("Cell Voltages & Balance Status: ");
-    for (int i=0; i < min(NUM_CELLS, numCells); i++) {
-        Serial.print("  ");
-        Serial.print(cellVoltages[i], 3);  // Returns the cell voltage, in volts
-        Serial.print("V  ");
-        Serial.println(isBalancing(i) ? "(balancing)" : "(not balancing)");
-    }
-
     Serial.print("BMS Name:         ");
     Serial.println(name);
-    Serial.println();
 }
 #endif
 
-void BMS::queryBasicInfo() {
+// pipelined, every query goes out at once and the responses are told apart by their command byte;
+// otherwise each query follows the response to the previous one
+void BmsCore::sendQueries() {
+    while (unsentQueries != 0) {
+        uint8_t query = unsentQueries & -unsentQueries; // lowest bit, queries go out in command order
+        uint8_t *command = query == QUERY_BASIC_INFO ? basicSystemInfoCommand
+                         : query == QUERY_CELL_VOLTAGES ? cellVoltagesCommand : nameCommand;
 #if BMS_OPTION_DEBUG
-    Serial.println("Query 0x03 Basic Info");
+        Serial.print("Query 0x0");
+        Serial.println(command[2], HEX);
 #endif
-    if(serial->availableForWrite()){
-        serial->write(basicSystemInfoCommand, sizeof(basicSystemInfoCommand));
-    }
-
-    uint8_t buffer[RX_BUFFER_SIZE] {0};
-
-    int bytesReceived = serial->readBytesUntil((char)STOP_BYTE, buffer, sizeof(buffer));
-    comError = validateResponse(buffer, CMD_BASIC_SYSTEM_INFO, bytesReceived);
-    if(comError){
-        return;
+        if (serial->availableForWrite()) {
+            serial->write(command, 7);
+        }
+        unsentQueries &= ~query;
+        awaitedResponses |= query;
+        if (!pipelined) {
+            break;
+        }
     }
+    requestTime = millis();
+}
 
-    parseBasicInfoResponse(buffer);
-
-}
-
-void BMS::parseBasicInfoResponse(const uint8_t *buffer) {
-    totalVoltage = 0.01f * ((uint16_t)(buffer[4] << 8u) | (uint16_t)(buffer[5]));
-    current = ((uint16_t)(buffer[6] << 8u) | (uint16_t)(buffer[7])) * 0.01;
-    balanceCapacity = ((uint16_t)(buffer[8] << 8u) | (uint16_t)(buffer[9])) * 0.01;
-    rateCapacity = ((uint16_t)(buffer[10] << 8u) | (uint16_t)(buffer[11])) * 0.01;
-    cycleCount = (uint16_t)(buffer[12] << 8u) | (uint16_t)(buffer[13]);
-    productionDate = (uint16_t)(buffer[14] << 8u) | (uint16_t)(buffer[15]);
-    balanceStatus = (uint32_t)(buffer[16] << 8u) | (uint32_t)(buffer[17]) | (uint32_t)(buffer[18] << 24u) | (uint32_t)(buffer[19] << 16u) ;
-    lastProtectionStatus = protectionStatus;
-    protectionStatus = (uint16_t)(buffer[20] << 8u) | (uint16_t)(buffer[21]);
-
-    // See if there are any new faults.  If so, then increment the count.
-    if (!lastProtectionStatus.singleCellOvervoltageProtection && protectionStatus.singleCellOvervoltageProtection)  { faultCounts.singleCellOvervoltageProtection += 1; }
-    if (!lastProtectionStatus.singleCellUndervoltageProtection && protectionStatus.singleCellUndervoltageProtection)  { faultCounts.singleCellUndervoltageProtection += 1; }
-    if (!lastProtectionStatus.wholePackOvervoltageProtection && protectionStatus.wholePackOvervoltageProtection)  { faultCounts.wholePackOvervoltageProtection += 1; }
-    if (!lastProtectionStatus.wholePackUndervoltageProtection && protectionStatus.wholePackUndervoltageProtection)  { faultCounts.wholePackUndervoltageProtection += 1; }
-    if (!lastProtectionStatus.chargingOverTemperatureProtection && protectionStatus.chargingOverTemperatureProtection)  { faultCounts.chargingOverTemperatureProtection += 1; }
-    if (!lastProtectionStatus.chargingLowTemperatureProtection && protectionStatus.chargingLowTemperatureProtection)  { faultCounts.chargingLowTemperatureProtection += 1; }
-    if (!lastProtectionStatus.dischargeOverTemperatureProtection && protectionStatus.dischargeOverTemperatureProtection)  { faultCounts.dischargeOverTemperatureProtection += 1; }
-    if (!lastProtectionStatus.dischargeLowTemperatureProtection && protectionStatus.dischargeLowTemperatureProtection)  { faultCounts.dischargeLowTemperatureProtection += 1; }
-    if (!lastProtectionStatus.chargingOvercurrentProtection && protectionStatus.chargingOvercurrentProtection)  { faultCounts.chargingOvercurrentProtection += 1; }
-    if (!lastProtectionStatus.dischargeOvercurrentProtection && protectionStatus.dischargeOvercurrentProtection)  { faultCounts.dischargeOvercurrentProtection += 1; }
-    if (!lastProtectionStatus.shortCircuitProtection && protectionStatus.shortCircuitProtection) { faultCounts.shortCircuitProtection += 1; }
-    if (!lastProtectionStatus.frontEndDetectionIcError && protectionStatus.frontEndDetectionIcError) { faultCounts.frontEndDetectionIcError += 1; }
-    if (!lastProtectionStatus.softwareLockMos && protectionStatus.softwareLockMos) { faultCounts.softwareLockMos += 1; }
-
-    softwareVersion = buffer[22];
-    stateOfCharge = buffer[23];
-    isDischargeFetEnabled = buffer[24] & 0b00000010u;
-    isChargeFetEnabled = buffer[24] & 0b00000001u;
-    numCells = buffer[25];
-    numTemperatureSensors = buffer[26];
-
-    for (int i = 0; i < min(numTemperatureSensors, NUM_TEMP_SENSORS); i++) {
-        temperatures[i] = ((uint16_t)(buffer[27 + (i * 2)] << 8u) | (uint16_t)(buffer[28 + (i * 2)])) * 0.1f - 273.15f;
+bool BmsCore::decodeField(const uint8_t *frame, FrameField field, int32_t &raw) {
+    if (field.offset + (field.format & FIELD_WIDTH_MASK) > FRAME_DATA + frame[3]) {
+        return false;
     }
+    raw = readField(frame, field);
+    return true;
 }
 
-
-void BMS::queryCellVoltages() {
-#if BMS_OPTION_DEBUG
-    Serial.println("Query 0x04 Cell Voltages");
-#endif
-
-    if(serial->availableForWrite()){
-        serial->write(cellVoltagesCommand, sizeof(cellVoltagesCommand));
+int32_t BmsCore::readField(const uint8_t *frame, FrameField field) {
+    uint8_t width = field.format & FIELD_WIDTH_MASK;
+    uint32_t bits = 0;
+    for (uint8_t i = 0; i < width; i++) {
+        bits = bits << 8u | frame[field.offset + i];
     }
-
-    uint8_t buffer[RX_BUFFER_SIZE] {0};
-    int bytesReceived = serial->readBytesUntil((char)STOP_BYTE, buffer, sizeof(buffer));
-    comError = validateResponse(buffer, CMD_CELL_VOLTAGES, bytesReceived);
-    if(comError){
-        return;
+    if ((field.format & FIELD_SIGNED) && width < 4 && (bits >> (8u * width - 1u)) != 0) {
+        return (int32_t) bits - ((int32_t) 1 << (8u * width));
     }
-
-    parseVoltagesResponse(buffer);
+    return (int32_t) bits;
 }
 
-void BMS::parseVoltagesResponse(const uint8_t *buffer) {
-    for (int i = 0; i < min(numCells, NUM_CELLS); i++) {
-        cellVoltages[i] = ((uint16_t)(buffer[i * 2 + 4] << 8u) | (uint16_t)(buffer[i * 2 + 5])) * 0.001f;
-    }
+float BmsCore::scaled(FrameField field, int32_t raw) {
+    float scale;
+    memcpy_P(&scale, &decimalScales[(field.format >> FIELD_DECIMALS_SHIFT) & 0x03u], sizeof(scale));
+    return raw * scale;
 }
 
-void BMS::queryBmsName() {
-#if BMS_OPTION_DEBUG
-    Serial.println("Query 0x05 BMS Name");
-#endif
-    if(serial->availableForWrite()){
-        serial->write(nameCommand, sizeof(nameCommand));
+bool BmsCore::parseBasicInfoResponse(const uint8_t *buffer) {
+    // the whole layout is checked against the length before any value changes
+    if (basicInfoEnd > FRAME_DATA + buffer[3]) {
+        return false;
     }
-
-    uint8_t buffer[RX_BUFFER_SIZE] {0};
-    int bytesReceived = serial->readBytesUntil((char)STOP_BYTE, buffer, sizeof(buffer));
-    comError = validateResponse(buffer, CMD_NAME, bytesReceived);
-    if(comError){
-        return;
+    int32_t values[NUM_BASIC_INFO_VALUES];
+    for (uint8_t i = 0; i < NUM_BASIC_INFO_VALUES; i++) {
+        values[i] = readField(buffer, basicInfoField(i));
     }
 
-    parseNameResponse(buffer);
+    totalVoltage = scaled(basicInfoField(VALUE_TOTAL_VOLTAGE), values[VALUE_TOTAL_VOLTAGE]);
+    current = scaled(basicInfoField(VALUE_CURRENT), values[VALUE_CURRENT]);
+    balanceCapacity = scaled(basicInfoField(VALUE_BALANCE_CAPACITY), values[VALUE_BALANCE_CAPACITY]);
+    rateCapacity = scaled(basicInfoField(VALUE_RATE_CAPACITY), values[VALUE_RATE_CAPACITY]);
+    cycleCount = (uint16_t) values[VALUE_CYCLE_COUNT];
+    productionDate = (uint16_t) values[VALUE_PRODUCTION_DATE];
+    balanceStatus = (uint32_t) values[VALUE_BALANCE_HIGH] << 16u | (uint16_t) values[VALUE_BALANCE_LOW];
+    uint16_t status = (uint16_t) values[VALUE_PROTECTION_STATUS];
+
+    // count the faults that were not active on the previous poll
+    uint16_t risen = status & ~protectionStatus.bits & FAULT_MASK;
+    for (uint8_t fault = 0; risen; fault++, risen >>= 1u) {
+        if (risen & 1u) {
+            faultCounts[fault]++;
+        }
+    }
+    protectionStatus = status;
+
+    softwareVersion = (uint8_t) values[VALUE_SOFTWARE_VERSION];
+    stateOfCharge = (uint8_t) values[VALUE_STATE_OF_CHARGE];
+    uint8_t fetStatus = (uint8_t) values[VALUE_FET_STATUS];
+    isDischargeFetEnabled = fetStatus & 0b00000010u;
+    isChargeFetEnabled = fetStatus & 0b00000001u;
+    numCells = (uint8_t) values[VALUE_NUM_CELLS];
+    numTemperatureSensors = (uint8_t) values[VALUE_NUM_TEMPERATURE_SENSORS];
+    return true;
 }
 
-void BMS::parseNameResponse(const uint8_t *buffer) {
-    name = String();
-    for(int i = 4; i < buffer[3] + 4; i++){
-        name.concat((char)buffer[i]);
-    }
+// the length byte is capped at the name size, a longer name is cut short
+void BmsCore::parseNameResponse(const uint8_t *buffer) {
+    uint8_t length = min(buffer[3], NAME_LENGTH);
+    memcpy(name, &buffer[FRAME_DATA], length);
+    name[length] = 0;
 }
 
-uint16_t BMS::calculateChecksum(uint8_t *buffer, int len) {
+uint16_t BmsCore::calculateChecksum(uint8_t *buffer, int len) {
     uint16_t checksum =0;
     for(int i = 0; i < len; i++){
         checksum += buffer[i];
@@ -362,7 +415,7 @@ uint16_t BMS::calculateChecksum(uint8_t *buffer, int len) {
     return 0xFFFF - checksum + 1;
 }
 
-bool BMS::validateResponse(uint8_t *buffer, uint8_t command, int bytesReceived) {
+bool BmsCore::validateResponse(uint8_t *buffer, uint8_t command, int bytesReceived) {
     if(bytesReceived <= 0) {
         return false;
     }
@@ -379,11 +432,123 @@ bool BMS::validateResponse(uint8_t *buffer, uint8_t command, int bytesReceived)
     return true;
 }
 
-void BMS::clear24Values() {
-    minVoltage24 = totalVoltage;
-    maxVoltage24 = totalVoltage;
-    maxCharge24 = current > 0 ? current : 0;
-    maxDischarge24 = current < -maxDischarge24 ? -current : 0;
+// the checksum is summed up as the bytes arrive, so only the first rxCapacity bytes of a frame need to be kept
+void BmsCore::receiveByte(uint8_t data) {
+    if (rxIndex == 0 && data != START_BYTE) {
+        return; // resynchronise on the next start byte
+    }
+
+    if (rxIndex < rxCapacity) {
+        rxBuffer[rxIndex] = data;
+    }
+    if (rxIndex == 2) {
+        rxSum = 0;
+    }
+    if (rxIndex == 3) {
+        // the length byte tells us where the frame ends, so payload bytes equal to STOP_BYTE are harmless
+        rxExpected = data + FRAME_OVERHEAD;
+    }
+    if (rxIndex >= 2 && (rxIndex <= 3 || rxIndex < rxExpected - 3)) {
+        rxSum += data;
+    } else if (rxIndex == rxExpected - 3) {
+        rxChecksum = (uint16_t) (data << 8u);
+    } else if (rxIndex == rxExpected - 2) {
+        rxChecksum |= data;
+    }
+    rxIndex++;
+
+    if (rxIndex > FRAME_DATA && rxIndex == rxExpected) {
+        rxIndex = 0;
+        if (data == STOP_BYTE) {
+            handleFrame();
+        }
+    }
+}
+
+void BmsCore::handleFrame() {
+    uint8_t command = rxBuffer[1];
+    bool valid = rxBuffer[2] == 0x00 && rxChecksum == (uint16_t) (0u - rxSum);
+    // a frame cut to the buffer keeps the data that fit, the parsers go by the length byte
+    if (rxExpected > rxCapacity) {
+        rxBuffer[3] = min(rxBuffer[3], (uint8_t) (rxCapacity - FRAME_OVERHEAD));
+    }
+    // a basic info frame too short for the layout counts as garbled as well
+    if (!valid || (command == CMD_BASIC_SYSTEM_INFO && !parseBasicInfoResponse(rxBuffer))) {
+        comError = true;
+        if (isBusy()) {
+            pollState = IDLE;
+        }
+        return;
+    }
+    comError = false;
+
+    switch (command) {
+        case CMD_BASIC_SYSTEM_INFO:
+            parseArrays(*this, rxBuffer);
+            add24Sample(totalVoltage, current);
+            break;
+        case CMD_CELL_VOLTAGES:
+            parseArrays(*this, rxBuffer);
+            break;
+        case CMD_NAME:
+            parseNameResponse(rxBuffer);
+            break;
+        default:
+            return;
+    }
+
+    uint8_t query = 1u << (command - CMD_BASIC_SYSTEM_INFO);
+    if (pollState == WAITING && (awaitedResponses & query)) {
+        awaitedResponses &= ~query;
+        if (unsentQueries != 0) {
+            sendQueries();
+        } else if (awaitedResponses == 0) {
+            // the cycle ends with the name reply as well, on a shared port it would run into the next pack's replies
+            completeCycle();
+        } else {
+            requestTime = millis();
+        }
+    }
+}
+
+void BmsCore::completeCycle() {
+    pollState = DONE;
+    dataGeneration++;
+}
+
+static int16_t hundredths(float value) {
+    float scaled = value * 100.0f;
+    return scaled >= 32767.0f ? 32767 : scaled <= -32767.0f ? -32767 : (int16_t) lroundf(scaled);
+}
+
+void BmsCore::add24Sample(float voltage, float current) {
+    uint32_t now = millis();
+    highVoltage.add(hundredths(voltage), now);
+    lowVoltage.add(-hundredths(voltage), now);
+    // a direction that did not occur counts as 0 A, like the running maxima did
+    chargeCurrent.add(current > 0 ? hundredths(current) : 0, now);
+    dischargeCurrent.add(current < 0 ? -hundredths(current) : 0, now);
+}
+
+float BmsCore::extreme(SlidingMax<EXTREME_BUCKETS, EXTREME_BUCKET_MILLIS> &window, int8_t sign) {
+    int16_t value;
+    return window.get(value, millis()) ? sign * value * 0.01f : 0;
+}
+
+float BmsCore::minVoltage24() {
+    return extreme(lowVoltage, -1);
+}
+
+float BmsCore::maxVoltage24() {
+    return extreme(highVoltage, 1);
+}
+
+float BmsCore::maxCharge24() {
+    return extreme(chargeCurrent, 1);
+}
+
+float BmsCore::maxDischarge24() {
+    return extreme(dischargeCurrent, 1);
 }
 
 #endif
\ No newline at end of file
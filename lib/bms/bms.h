@@ -35,15 +35,24 @@ POSSIBILITY OF SUCH DAMAGE.
 #ifndef POWER_CONTROLLER_EVERY_BMS_H
 #define POWER_CONTROLLER_EVERY_BMS_H
 
-#ifdef ARDUINO
+#if defined(ARDUINO) || defined(NATIVE_HAL)
 
 #include <Arduino.h>
+#include <window.h>
 
 #define BMS_OPTION_DEBUG false
 
-#define NUM_TEMP_SENSORS 2
-#define NUM_CELLS 8
-#define RX_BUFFER_SIZE 64
+#define NAME_LENGTH 32
+
+// a frame is DD cmd status len data[len] chkH chkL 77
+#define FRAME_OVERHEAD 7
+#define FRAME_DATA 4 // offset of data[0]
+#define BASIC_INFO_LENGTH(tempSensors) (23 + 2 * (tempSensors))
+#define CELL_VOLTAGES_LENGTH(cells) (2 * (cells))
+
+// trailing 24 h extremes, kept in hourly buckets
+#define EXTREME_BUCKETS 24
+#define EXTREME_BUCKET_MILLIS 3600000UL
 
 // Constants
 #define START_BYTE 0xDD
@@ -57,6 +66,14 @@ POSSIBILITY OF SUCH DAMAGE.
 #define CMD_NAME              0x05
 #define CMD_CTL_MOSFET        0xE1
 
+// queries of a poll cycle, bit (command - CMD_BASIC_SYSTEM_INFO)
+#define QUERY_BASIC_INFO    0x01
+#define QUERY_CELL_VOLTAGES 0x02
+#define QUERY_NAME          0x04
+#define QUERY_REQUIRED      (QUERY_BASIC_INFO | QUERY_CELL_VOLTAGES) // a cycle fails without these, an unanswered name only times out
+
+#define NAME_QUERY_ATTEMPTS 3 // a BMS that does not answer the name query is not asked again
+
 
 typedef struct SoftwareVersion {
     uint8_t major;
@@ -99,95 +116,102 @@ typedef struct ProductionDate {
     }
 } ProductionDate;
 
+// protection status bits as reported by the BMS, the same index selects the fault counter and name
+enum Fault : uint8_t {
+    FAULT_CELL_OVERVOLTAGE,
+    FAULT_CELL_UNDERVOLTAGE,
+    FAULT_PACK_OVERVOLTAGE,
+    FAULT_PACK_UNDERVOLTAGE,
+    FAULT_CHARGE_OVER_TEMPERATURE,
+    FAULT_CHARGE_LOW_TEMPERATURE,
+    FAULT_DISCHARGE_OVER_TEMPERATURE,
+    FAULT_DISCHARGE_LOW_TEMPERATURE,
+    FAULT_CHARGE_OVERCURRENT,
+    FAULT_DISCHARGE_OVERCURRENT,
+    FAULT_SHORT_CIRCUIT,
+    FAULT_FRONT_END_IC_ERROR,
+    FAULT_SOFTWARE_LOCK_MOS,
+    NUM_FAULTS
+};
+
+#define FAULT_MASK ((uint16_t) ((1u << NUM_FAULTS) - 1))
+
 typedef struct ProtectionStatus {
-    bool singleCellOvervoltageProtection;
-    bool singleCellUndervoltageProtection;
-    bool wholePackOvervoltageProtection;
-    bool wholePackUndervoltageProtection;
-    bool chargingOverTemperatureProtection;
-    bool chargingLowTemperatureProtection;
-    bool dischargeOverTemperatureProtection;
-    bool dischargeLowTemperatureProtection;
-    bool chargingOvercurrentProtection;
-    bool dischargeOvercurrentProtection;
-    bool shortCircuitProtection;
-    bool frontEndDetectionIcError;
-    bool softwareLockMos;
-
-    ProtectionStatus(){
-        singleCellOvervoltageProtection    = false;
-        singleCellUndervoltageProtection   = false;
-        wholePackOvervoltageProtection     = false;
-        wholePackUndervoltageProtection    = false;
-        chargingOverTemperatureProtection  = false;
-        chargingLowTemperatureProtection   = false;
-        dischargeOverTemperatureProtection = false;
-        dischargeLowTemperatureProtection  = false;
-        chargingOvercurrentProtection      = false;
-        dischargeOvercurrentProtection     = false;
-        shortCircuitProtection             = false;
-        frontEndDetectionIcError           = false;
-        softwareLockMos                    = false;
+    uint16_t bits; // bit n is set while Fault n is active
+
+    ProtectionStatus(uint16_t status = 0) : bits(status) {
     }
 
-    ProtectionStatus(uint16_t status) {
-        singleCellOvervoltageProtection    = status & 0b0000000000000001u;
-        singleCellUndervoltageProtection   = status & 0b0000000000000010u;
-        wholePackOvervoltageProtection     = status & 0b0000000000000100u;
-        wholePackUndervoltageProtection    = status & 0b0000000000001000u;
-        chargingOverTemperatureProtection  = status & 0b0000000000010000u;
-        chargingLowTemperatureProtection   = status & 0b0000000000100000u;
-        dischargeOverTemperatureProtection = status & 0b0000000001000000u;
-        dischargeLowTemperatureProtection  = status & 0b0000000010000000u;
-        chargingOvercurrentProtection      = status & 0b0000000100000000u;
-        dischargeOvercurrentProtection     = status & 0b0000001000000000u;
-        shortCircuitProtection             = status & 0b0000010000000000u;
-        frontEndDetectionIcError           = status & 0b0000100000000000u;
-        softwareLockMos                    = status & 0b0001000000000000u;
+    bool isSet(uint8_t fault) const {
+        return bits & (1u << fault);
     }
-} ProtectionStatus;
 
-typedef struct FaultCounts {
-    uint8_t singleCellOvervoltageProtection;
-    uint8_t singleCellUndervoltageProtection;
-    uint8_t wholePackOvervoltageProtection;
-    uint8_t wholePackUndervoltageProtection;
-    uint8_t chargingOverTemperatureProtection;
-    uint8_t chargingLowTemperatureProtection;
-    uint8_t dischargeOverTemperatureProtection;
-    uint8_t dischargeLowTemperatureProtection;
-    uint8_t chargingOvercurrentProtection;
-    uint8_t dischargeOvercurrentProtection;
-    uint8_t shortCircuitProtection;
-    uint8_t frontEndDetectionIcError;
-    uint8_t softwareLockMos;
-
-    FaultCounts(){
-        singleCellOvervoltageProtection = 0;
-        singleCellUndervoltageProtection = 0;
-        wholePackOvervoltageProtection = 0;
-        wholePackUndervoltageProtection = 0;
-        chargingOverTemperatureProtection = 0;
-        chargingLowTemperatureProtection = 0;
-        dischargeOverTemperatureProtection = 0;
-        dischargeLowTemperatureProtection = 0;
-        chargingOvercurrentProtection = 0;
-        dischargeOvercurrentProtection = 0;
-        shortCircuitProtection = 0;
-        frontEndDetectionIcError = 0;
-        softwareLockMos = 0;
+    bool isAnySet() const {
+        return bits & FAULT_MASK;
     }
-} FaultCounts;
+} ProtectionStatus;
+
+const char *faultName(uint8_t fault); // PROGMEM string, copy with strcpy_P
+#define FAULT_NAME_SIZE 32 // holds the longest fault name with its terminator
+
+// values of the basic info response, they index the fields of a BasicInfoLayout
+enum BasicInfoValue : uint8_t {
+    VALUE_TOTAL_VOLTAGE,
+    VALUE_CURRENT,
+    VALUE_BALANCE_CAPACITY,
+    VALUE_RATE_CAPACITY,
+    VALUE_CYCLE_COUNT,
+    VALUE_PRODUCTION_DATE,
+    VALUE_BALANCE_LOW, // cells 1-16
+    VALUE_BALANCE_HIGH, // cells 17-32
+    VALUE_PROTECTION_STATUS,
+    VALUE_SOFTWARE_VERSION,
+    VALUE_STATE_OF_CHARGE,
+    VALUE_FET_STATUS,
+    VALUE_NUM_CELLS,
+    VALUE_NUM_TEMPERATURE_SENSORS,
+    NUM_BASIC_INFO_VALUES
+};
 
+// format of a FrameField: width in bytes, big endian, and the decimal places of the raw value
+#define FIELD_WIDTH_MASK 0x07
+#define FIELD_SIGNED 0x08
+#define FIELD_DECIMALS_SHIFT 4
+#define FIELD_DECIMALS(decimals) ((decimals) << FIELD_DECIMALS_SHIFT)
 
-class BMS {
+typedef struct FrameField {
+    uint8_t offset; // from the start of the frame
+    uint8_t format;
+} FrameField;
+
+// where a firmware puts the basic info values, kept in PROGMEM
+typedef struct BasicInfoLayout {
+    FrameField fields[NUM_BASIC_INFO_VALUES]; // indexed by BasicInfoValue, all of them have to be in the frame
+    FrameField temperature; // of the first sensor in 0.1 K, the others follow at steps of its width
+} BasicInfoLayout;
+
+extern const BasicInfoLayout jbdBasicInfoLayout; // the default
+
+
+class BmsCore;
+
+// parses the per-cell and per-sensor arrays of a validated basic info or cell voltages frame
+typedef void (*FrameParser)(BmsCore &bms, const uint8_t *frame);
+
+// protocol and scalar values shared by every pack size, see BMS below for the arrays
+class BmsCore {
 public:
-    BMS();
 
-    void begin(Stream *port, uint16_t timeout = 2000); // serial port stream and timeout
-    void poll(); // Call this every time you want to poll the BMS
+    void begin(Stream *port, uint16_t timeout = 2000); // serial port stream and response timeout in ms
+    void setPipelined(bool enabled); // send all queries of a poll cycle at once (default) or one per response
+    // PROGMEM layout of the pack's firmware, one with longer frames than JBD's also needs a bigger BufferSize
+    void setBasicInfoLayout(const BasicInfoLayout *layout);
+    void poll(); // Call this every time you want to poll the BMS, starts a poll cycle and returns immediately
+    bool update(); // Call this on every loop pass, returns true once when a poll cycle has completed
     void end();    // End processing.  Call this to stop querying the BMS and processing data.
     bool hasComError() const;  // Returns true if there was a timeout or checksum error on the last call
+    bool isBusy() const; // Returns true while a poll cycle is waiting for responses
+    uint32_t generation() const; // Changes whenever a poll cycle completes or the statistics are cleared
 
     float totalVoltage;
     float current;
@@ -202,16 +226,15 @@ public:
     bool isChargeFetEnabled;
     uint8_t numCells;
     uint8_t numTemperatureSensors;
-    float temperatures[NUM_TEMP_SENSORS]{};
-    float cellVoltages[NUM_CELLS]{};
-    String name;
-    FaultCounts faultCounts;
-    float minVoltage24;
-    float maxVoltage24;
-    float maxCharge24;
-    float maxDischarge24;
-
-    void clear24Values();
+    char name[NAME_LENGTH + 1]{};
+    uint8_t faultCounts[NUM_FAULTS]{}; // rising edges per Fault
+
+    // extremes of the basic info samples of the trailing 24 h, 0 before the first sample
+    float minVoltage24();
+    float maxVoltage24();
+    float maxCharge24();
+    float maxDischarge24();
+    void add24Sample(float voltage, float current); // taken at millis(), called with every basic info response
     void clearFaultCounts();
     bool isBalancing(uint8_t cellNumber) const;
     void setMosfetControl(bool charge, bool discharge);
@@ -223,24 +246,175 @@ public:
     uint8_t  nameCommand[7] = {START_BYTE, READ, CMD_NAME, 0x00, 0xFF, 0xFB, STOP_BYTE};
 
     bool validateResponse(uint8_t *buffer, uint8_t command, int bytesReceived);
-    void parseBasicInfoResponse(const uint8_t *buffer);
-    void parseVoltagesResponse(const uint8_t *buffer);
+    void receiveByte(uint8_t data); // feeds one received byte into the frame receiver
+    // the parsers trust the length byte, the receiver only hands on frames that are as long as it says
+    bool parseBasicInfoResponse(const uint8_t *buffer); // false, with nothing changed, if a field is past the data
     void parseNameResponse(const uint8_t *buffer);
 
-#ifdef BMS_OPTION_DEBUG
+    // raw value of field in frame, false if it is not within the data of the frame
+    static bool decodeField(const uint8_t *frame, FrameField field, int32_t &raw);
+    static float scaled(FrameField field, int32_t raw); // raw value in units, e.g. 0.01 V to V
+
+#if BMS_OPTION_DEBUG
     void debug();  // Calling this method will print out the received data to the main serial port
 #endif
 
+protected:
+    // rxBuffer should hold the longest frame the owner wants to parse, longer frames are cut to its size
+    BmsCore(uint8_t *rxBuffer, uint8_t rxCapacity, FrameParser parseArrays);
+
+    const BasicInfoLayout *basicInfoLayout;
+    uint8_t basicInfoEnd; // frame length without checksum and stop byte that holds every field of the layout
+
+    FrameField basicInfoField(uint8_t value) const;
+    static int32_t readField(const uint8_t *frame, FrameField field);
+
 private:
+    enum PollState : uint8_t {
+        IDLE,
+        WAITING,
+        DONE
+    };
+
     bool isEnabled;
     Stream* serial{};
     bool comError;
     uint32_t balanceStatus;  // The cell balance statuses, stored as a bitfield
-    ProtectionStatus lastProtectionStatus;
-    void queryBasicInfo();
-    void queryCellVoltages();
-    void queryBmsName();
 
+    // frame receiver, frames are DD cmd status len data[len] chkH chkL 77
+    uint8_t *rxBuffer;
+    uint8_t rxCapacity;
+    FrameParser parseArrays;
+    uint16_t rxIndex;
+    uint16_t rxExpected; // total frame length, known once the length byte at offset 3 is in
+    uint16_t rxSum; // of the status, length and data bytes received so far
+    uint16_t rxChecksum; // as transmitted
+    PollState pollState;
+    bool pipelined;
+    uint8_t unsentQueries; // QUERY_ bits of this cycle still to be sent
+    uint8_t awaitedResponses; // QUERY_ bits sent but not answered yet
+    uint8_t nameQueries; // name queries sent so far
+    uint16_t responseTimeout;
+    uint32_t requestTime;
+    uint32_t dataGeneration;
+
+    // in 0.01 V and 0.01 A, the minimum voltage and the discharge are tracked negated
+    SlidingMax<EXTREME_BUCKETS, EXTREME_BUCKET_MILLIS> highVoltage;
+    SlidingMax<EXTREME_BUCKETS, EXTREME_BUCKET_MILLIS> lowVoltage;
+    SlidingMax<EXTREME_BUCKETS, EXTREME_BUCKET_MILLIS> chargeCurrent;
+    SlidingMax<EXTREME_BUCKETS, EXTREME_BUCKET_MILLIS> dischargeCurrent;
+
+    float extreme(SlidingMax<EXTREME_BUCKETS, EXTREME_BUCKET_MILLIS> &window, int8_t sign);
+
+    void sendQueries();
+    void handleFrame();
+    void completeCycle();
+
+};
+
+constexpr uint8_t maxFrameLength(uint8_t a, uint8_t b) {
+    return a > b ? a : b;
+}
+
+// longest response frame of a pack with the given cell and temperature sensor counts
+constexpr uint8_t bmsFrameLength(uint8_t cells, uint8_t tempSensors) {
+    return FRAME_OVERHEAD + maxFrameLength(maxFrameLength(BASIC_INFO_LENGTH(tempSensors), CELL_VOLTAGES_LENGTH(cells)),
+                                           NAME_LENGTH);
+}
+
+// BMS of a pack with Cells cells and TempSensors temperature sensors, the arrays are sized exactly and
+// the parse loops have compile time bounds; the data of longer frames, from a bigger pack, a longer name or a
+// firmware with more fields, is cut to the buffer
+template<uint8_t Cells, uint8_t TempSensors, uint8_t BufferSize = bmsFrameLength(Cells, TempSensors)>
+class BMS : public BmsCore {
+    static_assert(Cells > 0 && Cells <= 32, "the balance status holds 32 cells");
+    static_assert(BufferSize <= 255 - FRAME_OVERHEAD, "the frame length is kept in a byte");
+    static_assert(BufferSize >= FRAME_OVERHEAD + BASIC_INFO_LENGTH(TempSensors),
+                  "buffer too small for the basic info frame");
+    static_assert(BufferSize >= FRAME_OVERHEAD + CELL_VOLTAGES_LENGTH(Cells),
+                  "buffer too small for the cell voltages frame");
+    static_assert(BufferSize >= FRAME_OVERHEAD + NAME_LENGTH, "buffer too small for the name frame");
+
+public:
+    BMS() : BmsCore(rxStorage, BufferSize, parseArrays) {
+    }
+
+    static constexpr uint8_t cellCount() {
+        return Cells;
+    }
+
+    static constexpr uint8_t temperatureCount() {
+        return TempSensors;
+    }
+
+    float temperatures[TempSensors]{};
+    float cellVoltages[Cells]{};
+
+    bool parseBasicInfoResponse(const uint8_t *buffer) {
+        if (!BmsCore::parseBasicInfoResponse(buffer)) {
+            return false;
+        }
+        parseTemperatures(buffer);
+        return true;
+    }
+
+    void parseVoltagesResponse(const uint8_t *buffer) {
+        // the frame length gives the cell count, the basic info response may not have been parsed yet
+        uint8_t count = buffer[3] / 2;
+        for (uint8_t i = 0; i < Cells; i++) {
+            if (i < count) {
+                cellVoltages[i] = ((uint16_t)(buffer[FRAME_DATA + i * 2] << 8u) | (uint16_t)(buffer[FRAME_DATA + 1 + i * 2]))
+                                  * 0.001f;
+            }
+        }
+    }
+
+#if BMS_OPTION_DEBUG
+    void debug() {
+        BmsCore::debug();
+        Serial.println("Temperatures:");
+        for (uint8_t i = 0; i < min(TempSensors, numTemperatureSensors); i++) {
+            Serial.print("  ");
+            Serial.print(temperatures[i], 1);
+            Serial.println(" deg C");
+        }
+
+        Serial.println("Cell Voltages & Balance Status: ");
+        for (uint8_t i = 0; i < min(Cells, numCells); i++) {
+            Serial.print("  ");
+            Serial.print(cellVoltages[i], 3);  // Returns the cell voltage, in volts
+            Serial.print("V  ");
+            Serial.println(isBalancing(i) ? "(balancing)" : "(not balancing)");
+        }
+        Serial.println();
+    }
+#endif
+
+private:
+    uint8_t rxStorage[BufferSize]{};
+
+    // a sensor count beyond the data only fills the sensors that are there
+    void parseTemperatures(const uint8_t *buffer) {
+        FrameField field;
+        memcpy_P(&field, &basicInfoLayout->temperature, sizeof(field));
+        int32_t kelvin;
+        for (uint8_t i = 0; i < TempSensors; i++) {
+            if (i >= numTemperatureSensors || !decodeField(buffer, field, kelvin)) {
+                break;
+            }
+            temperatures[i] = scaled(field, kelvin) - 273.15f;
+            field.offset += field.format & FIELD_WIDTH_MASK;
+        }
+    }
+
+    static void parseArrays(BmsCore &bms, const uint8_t *frame) {
+        BMS &self = static_cast<BMS &>(bms);
+        if (frame[1] == CMD_BASIC_SYSTEM_INFO) {
+            self.parseTemperatures(frame);
+        } else {
+            self.parseVoltagesResponse(frame);
+        }
+    }
 };
 
 #endif
@@ -0,0 +1,75 @@
+#include <energy.h>
+
+// 0.01 A·ms per 0.01 Ah and 0.0001 W·ms per 0.1 Wh
+#define CHARGE_UNIT 3600000ULL
+#define ENERGY_UNIT 3600000000ULL
+
+EnergyCounter::EnergyCounter() : chargeIn(0), chargeOut(0), energyIn(0), energyOut(0), hasSample(false), sampleTime(0),
+        lastCurrent(0), lastPower(0) {
+}
+
+void EnergyCounter::integrate(int32_t a, int32_t b, uint32_t dt, uint64_t &positive, uint64_t &negative) {
+    if (a >= 0 && b >= 0) {
+        positive += ((uint64_t) a + (uint64_t) b) * dt / 2;
+    } else if (a <= 0 && b <= 0) {
+        negative += ((uint64_t) -(int64_t) a + (uint64_t) -(int64_t) b) * dt / 2;
+    } else {
+        // the line crosses zero after |a| / (|a| + |b|) of dt, each side is a triangle
+        uint64_t up = a > 0 ? a : b;
+        uint64_t down = a > 0 ? -(int64_t) b : -(int64_t) a;
+        positive += up * dt / (up + down) * up / 2;
+        negative += down * dt / (up + down) * down / 2;
+    }
+}
+
+void EnergyCounter::add(float voltage, float current, uint32_t now) {
+    int32_t centiAmps = lroundf(current * 100.0f);
+    int32_t power = lroundf(voltage * 100.0f) * centiAmps;
+    uint32_t dt = now - sampleTime;
+    if (hasSample && dt <= ENERGY_MAX_GAP) {
+        integrate(lastCurrent, centiAmps, dt, chargeIn, chargeOut);
+        integrate(lastPower, power, dt, energyIn, energyOut);
+    }
+    hasSample = true;
+    sampleTime = now;
+    lastCurrent = centiAmps;
+    lastPower = power;
+}
+
+static uint16_t saturate(uint32_t value, uint8_t divisor) {
+    value = (value + divisor / 2) / divisor;
+    return value > 0xFFFF ? 0xFFFF : (uint16_t) value;
+}
+
+void EnergyCounter::rollover(uint32_t day) {
+    history.push({day, saturate(charged(), 1), saturate(discharged(), 1), saturate(chargedWh(), 10),
+                  saturate(dischargedWh(), 10)});
+    chargeIn = 0;
+    chargeOut = 0;
+    energyIn = 0;
+    energyOut = 0;
+}
+
+uint32_t EnergyCounter::charged() const {
+    return chargeIn / CHARGE_UNIT;
+}
+
+uint32_t EnergyCounter::discharged() const {
+    return chargeOut / CHARGE_UNIT;
+}
+
+uint32_t EnergyCounter::chargedWh() const {
+    return energyIn / ENERGY_UNIT;
+}
+
+uint32_t EnergyCounter::dischargedWh() const {
+    return energyOut / ENERGY_UNIT;
+}
+
+uint8_t EnergyCounter::days() const {
+    return history.size();
+}
+
+const EnergyDay &EnergyCounter::operator[](uint8_t index) const {
+    return history[index];
+}
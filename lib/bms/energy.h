@@ -0,0 +1,57 @@
+//
+// Coulomb and energy counter, integrates the poll samples into Ah and Wh charged and discharged per day
+//
+// Each pair of consecutive samples adds a trapezoid over the millis() between them. A segment where the current
+// changes direction is split at the zero crossing so each part goes to its own side. The sums are kept in 64 bit
+// fixed-point, 0.01 A·ms and 0.0001 W·ms, so months of small increments lose nothing to float rounding.
+//
+
+#ifndef POWER_CONTROLLER_EVERY_ENERGY_H
+#define POWER_CONTROLLER_EVERY_ENERGY_H
+
+#include <Arduino.h>
+#include <ringbuffer.h>
+
+#define ENERGY_HISTORY_DAYS 14
+#define ENERGY_MAX_GAP 600000UL // ms, the pack is not integrated across a longer gap between samples
+
+typedef struct EnergyDay {
+    uint32_t day;          // epoch of the day's start
+    uint16_t charged;      // 0.01 Ah
+    uint16_t discharged;   // 0.01 Ah
+    uint16_t chargedWh;
+    uint16_t dischargedWh;
+} EnergyDay;
+
+class EnergyCounter {
+public:
+    EnergyCounter();
+
+    void add(float voltage, float current, uint32_t now); // call with every completed poll cycle, now in ms
+    void rollover(uint32_t day); // files the totals so far as the day that started at day and starts a new one
+
+    // totals since the last rollover
+    uint32_t charged() const; // 0.01 Ah
+    uint32_t discharged() const; // 0.01 Ah
+    uint32_t chargedWh() const; // 0.1 Wh
+    uint32_t dischargedWh() const; // 0.1 Wh
+
+    uint8_t days() const;
+    const EnergyDay &operator[](uint8_t index) const; // 0 is the oldest day
+
+    // splits the trapezoid between a and b over dt into its positive and negative areas
+    static void integrate(int32_t a, int32_t b, uint32_t dt, uint64_t &positive, uint64_t &negative);
+
+private:
+    uint64_t chargeIn;  // 0.01 A·ms
+    uint64_t chargeOut;
+    uint64_t energyIn;  // 0.0001 W·ms
+    uint64_t energyOut;
+    bool hasSample;
+    uint32_t sampleTime;
+    int32_t lastCurrent; // 0.01 A
+    int32_t lastPower;   // 0.0001 W
+    RingBuffer<EnergyDay, ENERGY_HISTORY_DAYS> history;
+};
+
+#endif //POWER_CONTROLLER_EVERY_ENERGY_H
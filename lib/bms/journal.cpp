@@ -0,0 +1,52 @@
+#include <journal.h>
+
+FaultJournal::FaultJournal() : lastStatus(0), changes(0) {
+}
+
+static int16_t hundredths(float value) {
+    float scaled = value * 100.0f;
+    return scaled >= 32767.0f ? 32767 : scaled <= -32768.0f ? -32768 : (int16_t) lroundf(scaled);
+}
+
+void FaultJournal::update(const ProtectionStatus &status, float voltage, float current, uint32_t time) {
+    uint16_t changed = (status.bits ^ lastStatus) & FAULT_MASK;
+    for (uint8_t fault = 0; changed; fault++, changed >>= 1u) {
+        if (changed & 1u) {
+            events.push({time, (uint8_t) (status.isSet(fault) ? fault | FAULT_EVENT_ACTIVE : fault),
+                         (uint16_t) hundredths(voltage), hundredths(current)});
+            changes++;
+        }
+    }
+    lastStatus = status.bits;
+}
+
+void FaultJournal::clear() {
+    events.clear();
+    changes++;
+}
+
+uint32_t FaultJournal::generation() const {
+    return changes;
+}
+
+uint16_t FaultJournal::size() const {
+    return events.size();
+}
+
+const FaultEvent &FaultJournal::operator[](uint16_t index) const {
+    return events[index];
+}
+
+// events are appended in time order, so the first newer one can be found by bisection
+uint16_t FaultJournal::after(uint32_t time) const {
+    uint16_t low = 0, high = events.size();
+    while (low < high) {
+        uint16_t middle = (low + high) / 2;
+        if (events[middle].time <= time) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
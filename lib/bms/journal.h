@@ -0,0 +1,40 @@
+//
+// Journal of BMS protection status transitions, one record for every fault that got set or cleared
+//
+
+#ifndef POWER_CONTROLLER_EVERY_JOURNAL_H
+#define POWER_CONTROLLER_EVERY_JOURNAL_H
+
+#include <bms.h>
+#include <ringbuffer.h>
+
+#define FAULT_JOURNAL_SIZE 64
+#define FAULT_EVENT_ACTIVE 0x80u // set in FaultEvent.fault when the fault became active, clear when it went away
+
+typedef struct FaultEvent {
+    uint32_t time;     // epoch seconds
+    uint8_t fault;     // Fault index | FAULT_EVENT_ACTIVE
+    uint16_t voltage;  // pack voltage, 0.01 V
+    int16_t current;   // pack current, 0.01 A
+} FaultEvent;
+
+class FaultJournal {
+public:
+    FaultJournal();
+
+    // records the transitions between the previous status and this one, call with every completed poll cycle
+    void update(const ProtectionStatus &status, float voltage, float current, uint32_t time);
+    void clear();
+
+    uint32_t generation() const; // changes whenever an event is recorded or the journal is cleared
+    uint16_t size() const;
+    const FaultEvent &operator[](uint16_t index) const; // 0 is the oldest event
+    uint16_t after(uint32_t time) const; // index of the first event newer than time, size() if there is none
+
+private:
+    RingBuffer<FaultEvent, FAULT_JOURNAL_SIZE> events;
+    uint16_t lastStatus;
+    uint32_t changes;
+};
+
+#endif //POWER_CONTROLLER_EVERY_JOURNAL_H
@@ -0,0 +1,41 @@
+#include <poller.h>
+
+AdaptivePoller::AdaptivePoller(uint32_t minInterval, uint32_t maxInterval) : minInterval(minInterval),
+        maxInterval(maxInterval), currentInterval(min(BMS_POLL_INTERVAL, maxInterval)), hasSample(false), sampleTime(0),
+        lastCurrent(0), lastVoltage(0) {
+}
+
+uint32_t AdaptivePoller::update(const BmsCore &bms) {
+    return update(bms.current, bms.totalVoltage, bms.protectionStatus.isAnySet());
+}
+
+uint32_t AdaptivePoller::update(float current, float voltage, bool protecting) {
+    uint32_t now = millis();
+    bool changing = protecting;
+    if (hasSample && now != sampleTime) {
+        float seconds = (now - sampleTime) / 1000.0f;
+        float currentStep = fabsf(current - lastCurrent);
+        float voltageStep = fabsf(voltage - lastVoltage);
+        changing = changing || currentStep > BMS_POLL_CURRENT_STEP || currentStep / seconds > BMS_POLL_CURRENT_SLOPE ||
+                   voltageStep > BMS_POLL_VOLTAGE_STEP || voltageStep / seconds > BMS_POLL_VOLTAGE_SLOPE;
+    }
+    hasSample = true;
+    sampleTime = now;
+    lastCurrent = current;
+    lastVoltage = voltage;
+
+    // fast on any change, then double back to the steady interval, and beyond it while the pack is idle
+    uint32_t target = fabsf(current) < BMS_POLL_IDLE_CURRENT ? maxInterval : min(BMS_POLL_INTERVAL, maxInterval);
+    if (changing) {
+        currentInterval = minInterval;
+    } else if (currentInterval < target) {
+        currentInterval = min(currentInterval * 2, target);
+    } else {
+        currentInterval = target;
+    }
+    return currentInterval;
+}
+
+uint32_t AdaptivePoller::interval() const {
+    return currentInterval;
+}
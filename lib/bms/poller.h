@@ -0,0 +1,40 @@
+//
+// Adaptive BMS poll interval, short while the pack is changing or protecting itself and long while it is idle
+//
+
+#ifndef POWER_CONTROLLER_EVERY_POLLER_H
+#define POWER_CONTROLLER_EVERY_POLLER_H
+
+#include <bms.h>
+
+#define BMS_POLL_MIN_INTERVAL 1000UL // ms, while the pack is changing
+#define BMS_POLL_INTERVAL 30000UL // ms, steady load or charge
+#define BMS_POLL_MAX_INTERVAL 300000UL // ms, idle pack
+
+// a change counts when it is fast or when it is large, at a long interval the slope of a step is diluted
+#define BMS_POLL_CURRENT_SLOPE 0.5f // A/s
+#define BMS_POLL_VOLTAGE_SLOPE 0.02f // V/s
+#define BMS_POLL_CURRENT_STEP 1.0f // A between two cycles
+#define BMS_POLL_VOLTAGE_STEP 0.1f // V between two cycles
+#define BMS_POLL_IDLE_CURRENT 0.2f // A, below this the pack counts as idle
+
+class AdaptivePoller {
+public:
+    explicit AdaptivePoller(uint32_t minInterval = BMS_POLL_MIN_INTERVAL, uint32_t maxInterval = BMS_POLL_MAX_INTERVAL);
+
+    // call with every completed poll cycle, returns the delay until the next poll in ms
+    uint32_t update(const BmsCore &bms);
+    uint32_t update(float current, float voltage, bool protecting); // the same for a bank of packs
+    uint32_t interval() const;
+
+private:
+    uint32_t minInterval;
+    uint32_t maxInterval;
+    uint32_t currentInterval;
+    bool hasSample;
+    uint32_t sampleTime; // millis() of the previous cycle
+    float lastCurrent;
+    float lastVoltage;
+};
+
+#endif //POWER_CONTROLLER_EVERY_POLLER_H
@@ -0,0 +1,101 @@
+//
+// Maximum over a sliding time window, O(1) amortised per sample in fixed memory
+//
+// Time is cut into buckets of BucketMillis. The maxima of the closed buckets that can still become the window
+// maximum are kept in a monotonic deque, decreasing from front to back: a bucket leaves at the back as soon as a newer
+// one reaches its value and at the front once it has aged out of the window. The window is the open bucket plus the
+// Buckets - 1 closed ones before it, so samples expire between (Buckets - 1) and Buckets bucket lengths after they
+// were taken. Use negated values for a sliding minimum.
+//
+
+#ifndef POWER_CONTROLLER_EVERY_WINDOW_H
+#define POWER_CONTROLLER_EVERY_WINDOW_H
+
+#include <stdint.h>
+
+template<uint8_t Buckets, uint32_t BucketMillis>
+class SlidingMax {
+    static_assert(Buckets >= 2 && Buckets <= 128, "bucket numbers are compared modulo 256");
+
+public:
+    SlidingMax() : entries{}, head(0), count(0), bucket(0), bucketStart(0), open(0), hasOpen(false), started(false) {}
+
+    void add(int16_t value, uint32_t now) {
+        advance(now);
+        if (!hasOpen || value > open) {
+            open = value;
+            hasOpen = true;
+        }
+    }
+
+    // false if there was no sample within the window
+    bool get(int16_t &value, uint32_t now) {
+        advance(now);
+        bool found = hasOpen;
+        value = open;
+        if (count > 0 && (!found || entries[head].value > value)) {
+            value = entries[head].value;
+            found = true;
+        }
+        return found;
+    }
+
+    void clear() {
+        count = 0;
+        hasOpen = false;
+    }
+
+private:
+    typedef struct Entry {
+        int16_t value;
+        uint8_t bucket;
+    } Entry;
+
+    Entry entries[Buckets - 1]; // closed buckets, circular from head
+    uint8_t head;
+    uint8_t count;
+    uint8_t bucket; // number of the open bucket, modulo 256
+    uint32_t bucketStart; // millis() at which the open bucket started
+    int16_t open; // maximum of the open bucket
+    bool hasOpen;
+    bool started;
+
+    void advance(uint32_t now) {
+        if (!started) {
+            started = true;
+            bucketStart = now;
+            return;
+        }
+        uint32_t elapsed = now - bucketStart;
+        if (elapsed < BucketMillis) {
+            return;
+        }
+        uint32_t passed = elapsed / BucketMillis;
+        bucketStart += passed * BucketMillis;
+        if (passed >= Buckets) {
+            clear();
+            return;
+        }
+        uint8_t closed = bucket;
+        bucket += (uint8_t) passed;
+        while (count > 0 && (uint8_t) (bucket - entries[head].bucket) >= Buckets) {
+            head = head + 1 == Buckets - 1 ? 0 : head + 1;
+            count--;
+        }
+        if (hasOpen) {
+            while (count > 0 && entries[slot(count - 1)].value <= open) {
+                count--;
+            }
+            entries[slot(count)] = {open, closed};
+            count++;
+            hasOpen = false;
+        }
+    }
+
+    uint8_t slot(uint8_t index) const {
+        uint8_t position = head + index;
+        return position >= Buckets - 1 ? position - (Buckets - 1) : position;
+    }
+};
+
+#endif //POWER_CONTROLLER_EVERY_WINDOW_H
@@ -0,0 +1,73 @@
+#include <archive.h>
+
+void SensorSummary::add(const SensorData &record) {
+    const int32_t values[SENSOR_CHANNELS] = {record.pressure, record.temperature, record.humidity};
+    for (uint8_t i = 0; i < SENSOR_CHANNELS; i++) {
+        sum[i] += values[i];
+        min[i] = count == 0 || values[i] < min[i] ? values[i] : min[i];
+        max[i] = count == 0 || values[i] > max[i] ? values[i] : max[i];
+    }
+    count++;
+}
+
+static int32_t average(int32_t sum, uint16_t count) {
+    return sum >= 0 ? (sum + count / 2) / count : (sum - count / 2) / count;
+}
+
+SensorRange summaryRange(const SensorSummary &summary) {
+    SensorRange range{};
+    range.time = summary.time;
+    for (uint8_t i = 0; i < SENSOR_CHANNELS; i++) {
+        range.min[i] = summary.min[i];
+        range.avg[i] = summary.count > 0 ? average(summary.sum[i], summary.count) : 0;
+        range.max[i] = summary.max[i];
+    }
+    return range;
+}
+
+// distance in units, rounded up and saturated to a byte
+static uint8_t spread(int32_t distance, int32_t unit) {
+    int32_t units = (distance + unit - 1) / unit;
+    return units < 0 ? 0 : units > 255 ? 255 : (uint8_t) units;
+}
+
+static uint8_t halfPercent(int32_t humidity, int32_t rounding) {
+    int32_t units = (humidity + rounding) / 50;
+    return units < 0 ? 0 : units > 255 ? 255 : (uint8_t) units;
+}
+
+SensorAggregate encodeAggregate(const SensorSummary &summary) {
+    SensorRange range = summaryRange(summary);
+    SensorAggregate aggregate{};
+    aggregate.count = summary.count < 255 ? summary.count : 255;
+
+    int32_t temperature = range.avg[SENSOR_TEMPERATURE];
+    aggregate.temperature = (int16_t) temperature;
+    aggregate.temperatureBelow = spread(temperature - range.min[SENSOR_TEMPERATURE], 10);
+    aggregate.temperatureAbove = spread(range.max[SENSOR_TEMPERATURE] - temperature, 10);
+
+    int32_t pressure = (range.avg[SENSOR_PRESSURE] + 1) / 2;
+    aggregate.pressure = pressure < 0 ? 0 : pressure > 0xFFFF ? 0xFFFF : (uint16_t) pressure;
+    aggregate.pressureBelow = spread(aggregate.pressure * 2 - range.min[SENSOR_PRESSURE], 10);
+    aggregate.pressureAbove = spread(range.max[SENSOR_PRESSURE] - aggregate.pressure * 2, 10);
+
+    aggregate.humidity[0] = halfPercent(range.min[SENSOR_HUMIDITY], 0);
+    aggregate.humidity[1] = halfPercent(range.avg[SENSOR_HUMIDITY], 25);
+    aggregate.humidity[2] = halfPercent(range.max[SENSOR_HUMIDITY], 49);
+    return aggregate;
+}
+
+SensorRange decodeAggregate(const SensorAggregate &aggregate, time_t time) {
+    SensorRange range{};
+    range.time = time;
+    range.avg[SENSOR_PRESSURE] = (int32_t) aggregate.pressure * 2;
+    range.min[SENSOR_PRESSURE] = range.avg[SENSOR_PRESSURE] - aggregate.pressureBelow * 10;
+    range.max[SENSOR_PRESSURE] = range.avg[SENSOR_PRESSURE] + aggregate.pressureAbove * 10;
+    range.avg[SENSOR_TEMPERATURE] = aggregate.temperature;
+    range.min[SENSOR_TEMPERATURE] = aggregate.temperature - aggregate.temperatureBelow * 10;
+    range.max[SENSOR_TEMPERATURE] = aggregate.temperature + aggregate.temperatureAbove * 10;
+    range.min[SENSOR_HUMIDITY] = aggregate.humidity[0] * 50;
+    range.avg[SENSOR_HUMIDITY] = aggregate.humidity[1] * 50;
+    range.max[SENSOR_HUMIDITY] = aggregate.humidity[2] * 50;
+    return range;
+}
@@ -0,0 +1,117 @@
+//
+// Round-robin archive tiers, the sensor records consolidated into hourly and daily min/avg/max slots
+//
+// Every record that goes into the 15 minute history is also added to the open slot of each tier. When a record falls
+// into a later slot the open one is encoded into a 12 byte SensorAggregate and appended to the tier's ring. Slot
+// times are implicit: the ring holds consecutive slots ending at the newest one, a slot without records is kept as
+// an aggregate with count 0.
+//
+
+#ifndef POWER_CONTROLLER_EVERY_ARCHIVE_H
+#define POWER_CONTROLLER_EVERY_ARCHIVE_H
+
+#include <history.h>
+
+// channels of SensorSummary and SensorRange
+#define SENSOR_PRESSURE    0
+#define SENSOR_TEMPERATURE 1
+#define SENSOR_HUMIDITY    2
+#define SENSOR_CHANNELS    3
+
+// min and max are stored as distances from the average, rounded outwards so the range always covers the records
+typedef struct SensorAggregate {
+    uint8_t count;            // records in the slot, 0 for a slot without records
+    int16_t temperature;      // average, 0.01 °C
+    uint8_t temperatureBelow; // average - min, 0.1 °C
+    uint8_t temperatureAbove; // max - average, 0.1 °C
+    uint16_t pressure;        // average, 2 Pa
+    uint8_t pressureBelow;    // average - min, 10 Pa
+    uint8_t pressureAbove;    // max - average, 10 Pa
+    uint8_t humidity[3];      // min, average, max, 0.5 %RH
+} SensorAggregate;
+
+// running sums of the records in one slot, in SensorData units
+typedef struct SensorSummary {
+    time_t time; // start of the slot
+    uint16_t count;
+    int32_t sum[SENSOR_CHANNELS];
+    int32_t min[SENSOR_CHANNELS];
+    int32_t max[SENSOR_CHANNELS];
+
+    void add(const SensorData &record);
+} SensorSummary;
+
+// min, average and max of one slot, in SensorData units
+typedef struct SensorRange {
+    time_t time;
+    int32_t min[SENSOR_CHANNELS];
+    int32_t avg[SENSOR_CHANNELS];
+    int32_t max[SENSOR_CHANNELS];
+} SensorRange;
+
+SensorRange summaryRange(const SensorSummary &summary);
+SensorAggregate encodeAggregate(const SensorSummary &summary);
+SensorRange decodeAggregate(const SensorAggregate &aggregate, time_t time);
+
+template<uint16_t Records, uint32_t SlotSeconds>
+class SensorTier {
+public:
+    SensorTier() : newest(0), open{} {}
+
+    void add(const SensorData &record) {
+        time_t slot = record.readoutTime - record.readoutTime % SlotSeconds;
+        if (open.count > 0 && slot != open.time) {
+            close();
+        }
+        open.time = slot;
+        open.add(record);
+    }
+
+    void clear() {
+        slots.clear();
+        open = SensorSummary{};
+    }
+
+    uint16_t size() const { return slots.size(); }
+    static constexpr uint16_t capacity() { return Records; }
+    static constexpr uint32_t slotSeconds() { return SlotSeconds; }
+    const SensorAggregate &operator[](uint16_t index) const { return slots[index]; } // 0 is the oldest slot
+    time_t time(uint16_t index) const { return newest - (time_t) (slots.size() - 1 - index) * SlotSeconds; }
+    const SensorSummary &current() const { return open; } // the slot still being filled, count 0 if none
+
+    // index of the first closed slot that starts after time, size() if there is none
+    uint16_t after(time_t time) const {
+        if (slots.isEmpty() || time < this->time(0)) {
+            return 0;
+        }
+        uint32_t index = (time - this->time(0)) / SlotSeconds + 1;
+        return index < slots.size() ? index : slots.size();
+    }
+
+private:
+    RingBuffer<SensorAggregate, Records> slots;
+    time_t newest; // start of the newest closed slot
+    SensorSummary open;
+
+    void close() {
+        if (!slots.isEmpty()) {
+            if (open.time <= newest) {
+                // the clock was set back, the ring would no longer be in time order
+                slots.clear();
+            } else {
+                time_t missing = (open.time - newest) / SlotSeconds - 1;
+                if (missing >= Records) {
+                    slots.clear();
+                }
+                for (; !slots.isEmpty() && missing > 0; missing--) {
+                    slots.push(SensorAggregate{});
+                }
+            }
+        }
+        slots.push(encodeAggregate(open));
+        newest = open.time;
+        open = SensorSummary{};
+    }
+};
+
+#endif //POWER_CONTROLLER_EVERY_ARCHIVE_H
@@ -0,0 +1,250 @@
+//
+// Compact sensor history, four bytes per 15 minute slot
+//
+// Records are grouped in blocks of consecutive slots. Each block keeps the absolute values and timestamp of its
+// oldest record, every following slot only stores the change from the previous slot, bit-packed into 32 bits:
+//
+//         33222222222211111111110000000000
+// Field   10987654321098765432109876543210  # bits  unit
+// ======  ================================  ======  =======
+// Temp:   xxxxxxxxxxx                       11      0.01 °C, -1024 marks an absolute record
+// Humid:             xxxxxxxxxxx            11      0.01 %RH
+// Press:                        xxxxxxxxxx  10      Pa
+//
+// A change that does not fit is stored as an absolute record in two entries instead, the marker entry followed by:
+//
+// Entry   Bits    Field
+// ======  ======  ================================
+// 1       20..14  pressure, bits 22..16
+// 1       13..0   humidity
+// 2       31..16  temperature
+// 2       15..0   pressure, bits 15..0
+//
+// Only a gap in the slots starts a new block, so values are never rounded and a jump costs one entry more rather than
+// a block.
+//
+
+#ifndef POWER_CONTROLLER_EVERY_HISTORY_H
+#define POWER_CONTROLLER_EVERY_HISTORY_H
+
+#include <stdint.h>
+#include <time.h>
+#include <ringbuffer.h>
+
+#define SENSOR_SLOT_SECONDS 900
+#define SENSOR_DELTA_ABSOLUTE 0x400u // temperature field of an absolute record's first entry
+
+typedef struct SensorData{
+    time_t readoutTime;
+    int32_t pressure;     // Pa
+    int16_t temperature;  // 0.01 °C
+    uint16_t humidity;    // 0.01 %RH
+} SensorData;
+
+typedef uint32_t SensorDelta;
+
+typedef struct SensorBlock{
+    SensorData first; // absolute values of the oldest record in the block
+    uint16_t count;
+    uint16_t entries; // delta entries of the block's records
+} SensorBlock;
+
+template<uint16_t Records, uint8_t Blocks>
+class SensorHistory {
+    static_assert(Records >= 2, "an absolute record takes two entries");
+
+public:
+    class const_iterator {
+    public:
+        const_iterator(const SensorHistory *history, uint16_t record) : history(history), record(record), entry(0), block(0), offset(0), current{} {
+            if (record < history->size()) {
+                current = history->blocks[0].first;
+            }
+        }
+
+        // positioned on the first record of a block, record and entry are that record's logical indices
+        const_iterator(const SensorHistory *history, uint16_t record, uint16_t entry, uint8_t block) : history(history), record(record), entry(entry), block(block), offset(0), current(history->blocks[block].first) {}
+
+        const SensorData &operator*() const { return current; }
+        const SensorData *operator->() const { return &current; }
+        bool operator==(const const_iterator &rhs) const { return record == rhs.record; }
+        bool operator!=(const const_iterator &rhs) const { return record != rhs.record; }
+
+        const_iterator &operator++() {
+            record++;
+            if (record >= history->size()) {
+                return *this;
+            }
+            entry += history->width(entry);
+            offset++;
+            if (offset == history->blocks[block].count) {
+                block++;
+                offset = 0;
+                current = history->blocks[block].first;
+            } else {
+                history->apply(current, entry);
+            }
+            return *this;
+        }
+
+    private:
+        const SensorHistory *history;
+        uint16_t record;
+        uint16_t entry; // first delta entry of the record
+        uint8_t block;
+        uint16_t offset; // position within the block
+        SensorData current;
+    };
+
+    SensorHistory() : last{}, records(0), changes(0) {}
+
+    void push(const SensorData &data) {
+        SensorDelta delta[2];
+        uint8_t entries = 0; // 0 starts a new block
+        if (!isEmpty() && data.readoutTime == last.readoutTime + SENSOR_SLOT_SECONDS) {
+            entries = encode(last, data, delta[0]) ? 1 : encodeAbsolute(data, delta) ? 2 : 0;
+        }
+        // records go one at a time, an absolute record takes at most two of the smallest ones
+        while (deltas.size() + (entries != 0 ? entries : 1) > Records) {
+            dropOldestRecord();
+        }
+        if (entries != 0 && !isEmpty()) {
+            for (uint8_t i = 0; i < entries; i++) {
+                deltas.push(delta[i]);
+            }
+            SensorBlock &newest = blocks[blocks.size() - 1];
+            newest.count++;
+            newest.entries += entries;
+        } else {
+            if (blocks.isFull()) {
+                dropOldestBlock();
+            }
+            // the first record of a block owns a delta entry too, its value is never read
+            deltas.push(0);
+            blocks.push({data, 1, 1});
+        }
+        records++;
+        last = data;
+        changes++;
+    }
+
+    void clear() {
+        deltas.clear();
+        blocks.clear();
+        records = 0;
+        changes++;
+    }
+
+    uint32_t generation() const { return changes; } // changes on every push and clear
+
+    uint16_t size() const { return records; }
+    bool isEmpty() const { return records == 0; }
+    static constexpr uint16_t capacity() { return Records; } // in delta entries, a record takes one or two
+    const SensorData &newest() const { return last; }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+
+    // first record newer than time, whole blocks before it are skipped without decoding their deltas
+    const_iterator after(time_t time) const {
+        uint16_t record = 0;
+        uint16_t entry = 0;
+        for (uint8_t block = 0; block < blocks.size(); block++) {
+            const SensorBlock &candidate = blocks[block];
+            if (candidate.first.readoutTime + (time_t) (candidate.count - 1) * SENSOR_SLOT_SECONDS > time) {
+                const_iterator position(this, record, entry, block);
+                while (position->readoutTime <= time) {
+                    ++position;
+                }
+                return position;
+            }
+            record += candidate.count;
+            entry += candidate.entries;
+        }
+        return end();
+    }
+
+    static bool encode(const SensorData &from, const SensorData &to, SensorDelta &delta) {
+        int32_t temperature = (int32_t) to.temperature - from.temperature;
+        int32_t humidity = (int32_t) to.humidity - from.humidity;
+        int32_t pressure = to.pressure - from.pressure;
+        if (temperature < -1023 || temperature > 1023 || humidity < -1024 || humidity > 1023 || pressure < -512 || pressure > 511) {
+            return false;
+        }
+        delta = ((uint32_t) (temperature & 0x7FF) << 21u) | ((uint32_t) (humidity & 0x7FF) << 10u) | (uint32_t) (pressure & 0x3FF);
+        return true;
+    }
+
+    static bool encodeAbsolute(const SensorData &data, SensorDelta *entries) {
+        if (data.pressure < 0 || data.pressure > 0x7FFFFF || data.humidity > 0x3FFF) {
+            return false;
+        }
+        entries[0] = ((uint32_t) SENSOR_DELTA_ABSOLUTE << 21u) | ((uint32_t) data.pressure >> 16u << 14u) | data.humidity;
+        entries[1] = ((uint32_t) (uint16_t) data.temperature << 16u) | ((uint32_t) data.pressure & 0xFFFF);
+        return true;
+    }
+
+    static bool isAbsolute(SensorDelta delta) {
+        return delta >> 21u == SENSOR_DELTA_ABSOLUTE;
+    }
+
+private:
+    RingBuffer<SensorDelta, Records> deltas; // one or two entries per record, in record order
+    RingBuffer<SensorBlock, Blocks> blocks;
+    SensorData last;
+    uint16_t records;
+    uint32_t changes;
+
+    uint8_t width(uint16_t entry) const {
+        return isAbsolute(deltas[entry]) ? 2 : 1;
+    }
+
+    // moves data on to the record stored at entry
+    void apply(SensorData &data, uint16_t entry) const {
+        SensorDelta delta = deltas[entry];
+        data.readoutTime += SENSOR_SLOT_SECONDS;
+        if (isAbsolute(delta)) {
+            SensorDelta low = deltas[entry + 1];
+            data.temperature = (int16_t) (uint16_t) (low >> 16u);
+            data.humidity = delta & 0x3FFF;
+            data.pressure = (int32_t) ((delta >> 14u & 0x7F) << 16u | (low & 0xFFFF));
+        } else {
+            data.temperature += signExtend(delta >> 21u, 11);
+            data.humidity += signExtend(delta >> 10u, 11);
+            data.pressure += signExtend(delta, 10);
+        }
+    }
+
+    static int16_t signExtend(uint32_t value, uint8_t bits) {
+        int16_t result = (int16_t) (value & ((1u << bits) - 1));
+        if (result & (1 << (bits - 1))) {
+            result -= (int16_t) (1 << bits);
+        }
+        return result;
+    }
+
+    void dropOldestRecord() {
+        SensorBlock &oldest = blocks[0];
+        for (uint8_t i = width(0); i > 0; i--) {
+            deltas.pop();
+            oldest.entries--;
+        }
+        records--;
+        if (--oldest.count == 0) {
+            blocks.pop();
+        } else {
+            // the next record becomes the block's first, fold its delta into the absolute values
+            apply(oldest.first, 0);
+        }
+    }
+
+    void dropOldestBlock() {
+        for (uint16_t i = blocks[0].entries; i > 0; i--) {
+            deltas.pop();
+        }
+        records -= blocks[0].count;
+        blocks.pop();
+    }
+};
+
+#endif //POWER_CONTROLLER_EVERY_HISTORY_H
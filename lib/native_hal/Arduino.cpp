@@ -0,0 +1,390 @@
+#include <Arduino.h>
+#include <ctype.h>
+#include <new>
+
+MockSerial Serial;
+MockSerial Serial1;
+MockSerial Serial2;
+
+static unsigned long mockMicros = 0;
+static uint8_t pinStates[32]{};
+
+unsigned long millis() {
+    return mockMicros / 1000;
+}
+
+unsigned long micros() {
+    return mockMicros;
+}
+
+void delay(unsigned long ms) {
+    mockMicros += ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us) {
+    mockMicros += us;
+}
+
+void setMockMicros(unsigned long us) {
+    mockMicros = us;
+}
+
+void advanceMockMillis(unsigned long ms) {
+    mockMicros += ms * 1000;
+}
+
+void pinMode(uint8_t, uint8_t) {
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    if (pin < sizeof(pinStates)) {
+        pinStates[pin] = value;
+    }
+}
+
+int digitalRead(uint8_t pin) {
+    return pin < sizeof(pinStates) ? pinStates[pin] : LOW;
+}
+
+// allocation accounting, the native env links with -Wl,--wrap for malloc, realloc and calloc
+static uint32_t allocations = 0;
+
+void resetAllocationCount() {
+    allocations = 0;
+}
+
+uint32_t allocationCount() {
+    return allocations;
+}
+
+extern "C" {
+void *__real_malloc(size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void *__real_calloc(size_t count, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    allocations++;
+    return __real_malloc(size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    allocations++;
+    return __real_realloc(ptr, size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    allocations++;
+    return __real_calloc(count, size);
+}
+}
+
+void *operator new(size_t size) {
+    void *ptr = malloc(size);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+    free(ptr);
+}
+
+// String, heap backed like the Arduino core so allocation counts match the target
+String::String(const char *cstr) : buffer(nullptr), capacity(0), len(0) {
+    if (cstr) {
+        copy(cstr, strlen(cstr));
+    }
+}
+
+String::String(const String &other) : buffer(nullptr), capacity(0), len(0) {
+    copy(other.c_str(), other.len);
+}
+
+String::String(char c) : buffer(nullptr), capacity(0), len(0) {
+    char text[2] = {c, 0};
+    copy(text, 1);
+}
+
+String::String(int value, unsigned char base) : String((long) value, base) {
+}
+
+String::String(unsigned int value, unsigned char base) : String((unsigned long) value, base) {
+}
+
+String::String(long value, unsigned char base) : buffer(nullptr), capacity(0), len(0) {
+    char text[34];
+    snprintf(text, sizeof(text), base == 16 ? "%lx" : "%ld", value);
+    copy(text, strlen(text));
+}
+
+String::String(unsigned long value, unsigned char base) : buffer(nullptr), capacity(0), len(0) {
+    char text[34];
+    snprintf(text, sizeof(text), base == 16 ? "%lx" : "%lu", value);
+    copy(text, strlen(text));
+}
+
+String::String(float value, unsigned char decimalPlaces) : String((double) value, decimalPlaces) {
+}
+
+String::String(double value, unsigned char decimalPlaces) : buffer(nullptr), capacity(0), len(0) {
+    char text[34];
+    snprintf(text, sizeof(text), "%.*f", decimalPlaces, value);
+    copy(text, strlen(text));
+}
+
+String::~String() {
+    free(buffer);
+}
+
+String &String::operator=(const String &rhs) {
+    if (this != &rhs) {
+        copy(rhs.c_str(), rhs.len);
+    }
+    return *this;
+}
+
+String &String::operator=(const char *cstr) {
+    return copy(cstr ? cstr : "", cstr ? strlen(cstr) : 0);
+}
+
+bool String::reserve(unsigned int size) {
+    if (buffer && capacity >= size) {
+        return true;
+    }
+    char *grown = (char *) realloc(buffer, size + 1);
+    if (!grown) {
+        return false;
+    }
+    if (!buffer) {
+        grown[0] = 0;
+    }
+    buffer = grown;
+    capacity = size;
+    return true;
+}
+
+String &String::copy(const char *cstr, unsigned int length) {
+    if (!reserve(length)) {
+        return *this;
+    }
+    memmove(buffer, cstr, length);
+    buffer[length] = 0;
+    len = length;
+    return *this;
+}
+
+bool String::concat(const String &s) {
+    return concat(s.c_str());
+}
+
+bool String::concat(const char *cstr) {
+    unsigned int length = strlen(cstr);
+    if (!reserve(len + length)) {
+        return false;
+    }
+    memcpy(buffer + len, cstr, length + 1);
+    len += length;
+    return true;
+}
+
+bool String::concat(char c) {
+    char text[2] = {c, 0};
+    return concat(text);
+}
+
+bool String::equals(const String &s) const {
+    return len == s.len && strcmp(c_str(), s.c_str()) == 0;
+}
+
+bool String::equals(const char *cstr) const {
+    return strcmp(c_str(), cstr ? cstr : "") == 0;
+}
+
+bool String::startsWith(const String &prefix) const {
+    return prefix.len <= len && strncmp(c_str(), prefix.c_str(), prefix.len) == 0;
+}
+
+bool String::endsWith(const String &suffix) const {
+    return suffix.len <= len && strcmp(c_str() + len - suffix.len, suffix.c_str()) == 0;
+}
+
+int String::indexOf(char c, unsigned int fromIndex) const {
+    if (fromIndex >= len) {
+        return -1;
+    }
+    const char *found = strchr(c_str() + fromIndex, c);
+    return found ? (int) (found - c_str()) : -1;
+}
+
+int String::lastIndexOf(char c) const {
+    const char *found = strrchr(c_str(), c);
+    return found ? (int) (found - c_str()) : -1;
+}
+
+String String::substring(unsigned int beginIndex) const {
+    return substring(beginIndex, len);
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const {
+    if (beginIndex > endIndex) {
+        unsigned int swap = beginIndex;
+        beginIndex = endIndex;
+        endIndex = swap;
+    }
+    String result;
+    if (beginIndex >= len) {
+        return result;
+    }
+    if (endIndex > len) {
+        endIndex = len;
+    }
+    result.copy(c_str() + beginIndex, endIndex - beginIndex);
+    return result;
+}
+
+long String::toInt() const {
+    return atol(c_str());
+}
+
+float String::toFloat() const {
+    return (float) atof(c_str());
+}
+
+void String::trim() {
+    unsigned int begin = 0;
+    while (begin < len && isspace((unsigned char) buffer[begin])) {
+        begin++;
+    }
+    unsigned int end = len;
+    while (end > begin && isspace((unsigned char) buffer[end - 1])) {
+        end--;
+    }
+    if (begin > 0 || end < len) {
+        memmove(buffer, buffer + begin, end - begin);
+        len = end - begin;
+        buffer[len] = 0;
+    }
+}
+
+size_t Print::write(const uint8_t *data, size_t size) {
+    size_t n = 0;
+    while (size--) {
+        n += write(*data++);
+    }
+    return n;
+}
+
+size_t Print::print(long value, int base) {
+    char text[34];
+    snprintf(text, sizeof(text), base == HEX ? "%lX" : "%ld", value);
+    return write(text);
+}
+
+size_t Print::print(unsigned long value, int base) {
+    char text[34];
+    snprintf(text, sizeof(text), base == HEX ? "%lX" : "%lu", value);
+    return write(text);
+}
+
+size_t Print::print(double value, int digits) {
+    char text[34];
+    snprintf(text, sizeof(text), "%.*f", digits, value);
+    return write(text);
+}
+
+int Stream::timedRead() {
+    unsigned long start = millis();
+    do {
+        int c = read();
+        if (c >= 0) {
+            return c;
+        }
+        // nothing will arrive in the mock, so account for the timeout the target would burn
+        advanceMockMillis(1);
+    } while (millis() - start < streamTimeout);
+    return -1;
+}
+
+size_t Stream::readBytes(char *buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+        int c = timedRead();
+        if (c < 0) {
+            break;
+        }
+        buffer[count++] = (char) c;
+    }
+    return count;
+}
+
+size_t Stream::readBytesUntil(char terminator, char *buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+        int c = timedRead();
+        if (c < 0 || c == terminator) {
+            break;
+        }
+        buffer[count++] = (char) c;
+    }
+    return count;
+}
+
+String Stream::readString() {
+    String result;
+    int c = timedRead();
+    while (c >= 0) {
+        result += (char) c;
+        c = timedRead();
+    }
+    return result;
+}
+
+String Stream::readStringUntil(char terminator) {
+    String result;
+    int c = timedRead();
+    while (c >= 0 && c != terminator) {
+        result += (char) c;
+        c = timedRead();
+    }
+    return result;
+}
+
+size_t MockSerial::write(uint8_t c) {
+    if (txCount < sizeof(txBuffer)) {
+        txBuffer[txCount++] = c;
+    }
+    return 1;
+}
+
+void MockSerial::inject(const uint8_t *data, size_t length) {
+    if (rxPosition == rxLength) {
+        rxPosition = 0;
+        rxLength = 0;
+    }
+    for (size_t i = 0; i < length && rxLength < sizeof(rxData); i++) {
+        rxData[rxLength++] = data[i];
+    }
+}
+
+void MockSerial::clear() {
+    rxPosition = 0;
+    rxLength = 0;
+    txCount = 0;
+}
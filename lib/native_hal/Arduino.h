@@ -0,0 +1,192 @@
+//
+// Minimal host stand-in for the Arduino core, just enough for lib/bms and lib/web to build and run on x86
+//
+
+#ifndef POWER_CONTROLLER_EVERY_NATIVE_ARDUINO_H
+#define POWER_CONTROLLER_EVERY_NATIVE_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+#ifndef NATIVE_HAL
+#define NATIVE_HAL
+#endif
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW  0x0
+#define INPUT 0x0
+#define OUTPUT 0x1
+
+#define DEC 10
+#define HEX 16
+
+#define PROGMEM
+#define F(string_literal) (string_literal)
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_ptr(addr) (*(void * const *)(addr))
+#define strcpy_P strcpy
+#define strlen_P strlen
+#define memcpy_P memcpy
+
+#ifndef min
+#define min(a,b) ((a)<(b)?(a):(b))
+#endif
+#ifndef max
+#define max(a,b) ((a)>(b)?(a):(b))
+#endif
+
+// time, driven by the test instead of a hardware timer
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void setMockMicros(unsigned long us);
+void advanceMockMillis(unsigned long ms);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+// allocation accounting, counts every malloc/realloc/calloc/new since the last reset
+void resetAllocationCount();
+uint32_t allocationCount();
+
+class String {
+public:
+    String(const char *cstr = "");
+    String(const String &other);
+    explicit String(char c);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(float value, unsigned char decimalPlaces = 2);
+    explicit String(double value, unsigned char decimalPlaces = 2);
+    ~String();
+
+    String &operator=(const String &rhs);
+    String &operator=(const char *cstr);
+    String &operator+=(const String &rhs) { concat(rhs); return *this; }
+    String &operator+=(const char *cstr) { concat(cstr); return *this; }
+    String &operator+=(char c) { concat(c); return *this; }
+
+    bool concat(const String &s);
+    bool concat(const char *cstr);
+    bool concat(char c);
+
+    unsigned int length() const { return len; }
+    const char *c_str() const { return buffer ? buffer : ""; }
+    char charAt(unsigned int index) const { return index < len ? buffer[index] : 0; }
+    char operator[](unsigned int index) const { return charAt(index); }
+
+    bool equals(const String &s) const;
+    bool equals(const char *cstr) const;
+    bool operator==(const String &rhs) const { return equals(rhs); }
+    bool operator==(const char *cstr) const { return equals(cstr); }
+    bool operator!=(const String &rhs) const { return !equals(rhs); }
+    bool operator!=(const char *cstr) const { return !equals(cstr); }
+    bool startsWith(const String &prefix) const;
+    bool endsWith(const String &suffix) const;
+
+    int indexOf(char c, unsigned int fromIndex = 0) const;
+    int lastIndexOf(char c) const;
+    String substring(unsigned int beginIndex) const;
+    String substring(unsigned int beginIndex, unsigned int endIndex) const;
+    long toInt() const;
+    float toFloat() const;
+    void trim();
+
+private:
+    char *buffer;
+    unsigned int capacity;
+    unsigned int len;
+
+    bool reserve(unsigned int size);
+    String &copy(const char *cstr, unsigned int length);
+};
+
+class Print {
+public:
+    virtual ~Print() = default;
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *data, size_t size);
+    size_t write(const char *str) { return str ? write((const uint8_t *) str, strlen(str)) : 0; }
+    size_t write(const char *data, size_t size) { return write((const uint8_t *) data, size); }
+    virtual int availableForWrite() { return 0; }
+    virtual void flush() {}
+
+    size_t print(const char *str) { return write(str); }
+    size_t print(const String &s) { return write(s.c_str(), s.length()); }
+    size_t print(char c) { return write((uint8_t) c); }
+    size_t print(unsigned char value, int base = DEC) { return print((unsigned long) value, base); }
+    size_t print(int value, int base = DEC) { return print((long) value, base); }
+    size_t print(unsigned int value, int base = DEC) { return print((unsigned long) value, base); }
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+    size_t print(double value, int digits = 2);
+
+    size_t println() { return write("\r\n"); }
+    template<typename T> size_t println(const T &value) { size_t n = print(value); return n + println(); }
+    template<typename T> size_t println(const T &value, int format) { size_t n = print(value, format); return n + println(); }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeout) { streamTimeout = timeout; }
+    size_t readBytes(char *buffer, size_t length);
+    size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *) buffer, length); }
+    size_t readBytesUntil(char terminator, char *buffer, size_t length);
+    size_t readBytesUntil(char terminator, uint8_t *buffer, size_t length) { return readBytesUntil(terminator, (char *) buffer, length); }
+    String readString();
+    String readStringUntil(char terminator);
+
+protected:
+    unsigned long streamTimeout = 1000;
+    int timedRead();
+};
+
+// serial port backed by in-memory buffers, the test feeds rx and inspects tx
+class MockSerial : public Stream {
+public:
+    void begin(unsigned long) {}
+    void end() {}
+    explicit operator bool() const { return true; }
+
+    int available() override { return (int) (rxLength - rxPosition); }
+    int read() override { return rxPosition < rxLength ? rxData[rxPosition++] : -1; }
+    int peek() override { return rxPosition < rxLength ? rxData[rxPosition] : -1; }
+    size_t write(uint8_t c) override;
+    using Print::write;
+    int availableForWrite() override { return 64; }
+
+    void inject(const uint8_t *data, size_t length);
+    void clear();
+    size_t txLength() const { return txCount; }
+    const uint8_t *txData() const { return txBuffer; }
+
+private:
+    uint8_t rxData[1024]{};
+    size_t rxLength = 0;
+    size_t rxPosition = 0;
+    uint8_t txBuffer[1024]{};
+    size_t txCount = 0;
+};
+
+extern MockSerial Serial;
+extern MockSerial Serial1;
+extern MockSerial Serial2;
+
+#endif //POWER_CONTROLLER_EVERY_NATIVE_ARDUINO_H
@@ -0,0 +1,16 @@
+//
+// Host stand-in for the Ethernet library's DNS client, every name resolves to the same address
+//
+
+#ifndef POWER_CONTROLLER_EVERY_NATIVE_DNS_H
+#define POWER_CONTROLLER_EVERY_NATIVE_DNS_H
+
+#include <Ethernet.h>
+
+class DNSClient {
+public:
+    void begin(const IPAddress &) {}
+    int getHostByName(const char *, IPAddress &result, uint16_t = 5000) { result = IPAddress(132, 163, 97, 1); return 1; }
+};
+
+#endif //POWER_CONTROLLER_EVERY_NATIVE_DNS_H
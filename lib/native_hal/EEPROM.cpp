@@ -0,0 +1,36 @@
+#include <EEPROM.h>
+
+EEPROMClass EEPROM;
+
+static uint8_t cells[MOCK_EEPROM_SIZE];
+static uint32_t writes[MOCK_EEPROM_SIZE];
+
+uint8_t EEPROMClass::read(int index) {
+    return index >= 0 && index < MOCK_EEPROM_SIZE ? cells[index] : 0xFF;
+}
+
+void EEPROMClass::write(int index, uint8_t value) {
+    if (index >= 0 && index < MOCK_EEPROM_SIZE) {
+        cells[index] = value;
+        writes[index]++;
+    }
+}
+
+void EEPROMClass::update(int index, uint8_t value) {
+    if (read(index) != value) {
+        write(index, value);
+    }
+}
+
+uint16_t EEPROMClass::length() {
+    return MOCK_EEPROM_SIZE;
+}
+
+void mockEepromErase() {
+    memset(cells, 0xFF, sizeof(cells));
+    memset(writes, 0, sizeof(writes));
+}
+
+uint32_t mockEepromWrites(int index) {
+    return writes[index];
+}
@@ -0,0 +1,44 @@
+//
+// Host stand-in for the Arduino EEPROM library, 256 bytes in RAM like the ATmega4809's EEPROM
+//
+
+#ifndef POWER_CONTROLLER_EVERY_NATIVE_EEPROM_H
+#define POWER_CONTROLLER_EVERY_NATIVE_EEPROM_H
+
+#include <Arduino.h>
+
+#define MOCK_EEPROM_SIZE 256
+
+class EEPROMClass {
+public:
+    uint8_t read(int index);
+    void write(int index, uint8_t value);
+    void update(int index, uint8_t value); // only writes when the value differs, like the real library
+    uint16_t length();
+
+    template<typename T>
+    T &get(int index, T &value) {
+        uint8_t *bytes = (uint8_t *) &value;
+        for (size_t i = 0; i < sizeof(T); i++) {
+            bytes[i] = read(index + i);
+        }
+        return value;
+    }
+
+    template<typename T>
+    const T &put(int index, const T &value) {
+        const uint8_t *bytes = (const uint8_t *) &value;
+        for (size_t i = 0; i < sizeof(T); i++) {
+            update(index + i, bytes[i]);
+        }
+        return value;
+    }
+};
+
+extern EEPROMClass EEPROM;
+
+// test control, cells read 0 until the first erase and 0xFF after it
+void mockEepromErase();
+uint32_t mockEepromWrites(int index); // writes to one cell since the last erase
+
+#endif //POWER_CONTROLLER_EVERY_NATIVE_EEPROM_H
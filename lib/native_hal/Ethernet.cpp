@@ -0,0 +1,128 @@
+#include <Ethernet.h>
+
+EthernetClass Ethernet;
+
+void mockSocketReset(MockSocket &socket, const char *request) {
+    socket.rxLength = 0;
+    socket.rxPosition = 0;
+    socket.txLength = 0;
+    socket.writeCalls = 0;
+    socket.connected = true;
+    size_t length = strlen(request);
+    if (length > sizeof(socket.rx)) {
+        length = sizeof(socket.rx);
+    }
+    memcpy(socket.rx, request, length);
+    socket.rxLength = length;
+}
+
+int EthernetClient::available() {
+    if (!socket || !socket->connected) {
+        return 0;
+    }
+    return (int) (socket->rxLength - socket->rxPosition);
+}
+
+int EthernetClient::read() {
+    if (available() <= 0) {
+        return -1;
+    }
+    return socket->rx[socket->rxPosition++];
+}
+
+int EthernetClient::read(uint8_t *buffer, size_t size) {
+    size_t count = 0;
+    while (count < size && available() > 0) {
+        buffer[count++] = socket->rx[socket->rxPosition++];
+    }
+    return (int) count;
+}
+
+int EthernetClient::peek() {
+    if (available() <= 0) {
+        return -1;
+    }
+    return socket->rx[socket->rxPosition];
+}
+
+size_t EthernetClient::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t EthernetClient::write(const uint8_t *data, size_t size) {
+    if (!socket || !socket->connected) {
+        return 0;
+    }
+    socket->writeCalls++;
+    size_t room = sizeof(socket->tx) - socket->txLength;
+    if (size > room) {
+        size = room;
+    }
+    memcpy(socket->tx + socket->txLength, data, size);
+    socket->txLength += size;
+    return size;
+}
+
+int EthernetClient::availableForWrite() {
+    return socket && socket->connected ? 2048 : 0;
+}
+
+void EthernetClient::stop() {
+    if (socket) {
+        socket->connected = false;
+    }
+    socket = nullptr;
+}
+
+uint8_t EthernetClient::connected() {
+    return socket && (socket->connected || available() > 0);
+}
+
+EthernetClient EthernetServer::available() {
+    if (pendingCount == 0) {
+        return EthernetClient();
+    }
+    MockSocket *socket = pending[0];
+    pendingCount--;
+    memmove(pending, pending + 1, pendingCount * sizeof(pending[0]));
+    return EthernetClient(socket);
+}
+
+void EthernetServer::mockConnect(MockSocket *socket) {
+    if (pendingCount < MAX_SOCK_NUM) {
+        pending[pendingCount++] = socket;
+    }
+}
+
+EthernetClient EthernetServer::accept() {
+    return available();
+}
+
+size_t EthernetUDP::write(const uint8_t *data, size_t size) {
+    size_t count = min(size, sizeof(tx) - txLength);
+    memcpy(tx + txLength, data, count);
+    txLength += count;
+    return count;
+}
+
+int EthernetUDP::parsePacket() {
+    if (!rxPending) {
+        return 0;
+    }
+    rxPending = false;
+    rxPosition = 0;
+    return (int) rxLength;
+}
+
+int EthernetUDP::read(uint8_t *buffer, size_t size) {
+    size_t count = min(size, rxLength - rxPosition);
+    memcpy(buffer, rx + rxPosition, count);
+    rxPosition += count;
+    return (int) count;
+}
+
+void EthernetUDP::mockReply(const uint8_t *data, size_t size) {
+    rxLength = min(size, sizeof(rx));
+    memcpy(rx, data, rxLength);
+    rxPending = true;
+}
@@ -0,0 +1,106 @@
+//
+// Host stand-in for the Arduino Ethernet library, clients are backed by in-memory sockets
+//
+
+#ifndef POWER_CONTROLLER_EVERY_NATIVE_ETHERNET_H
+#define POWER_CONTROLLER_EVERY_NATIVE_ETHERNET_H
+
+#include <Arduino.h>
+
+#define MAX_SOCK_NUM 8
+
+class IPAddress {
+public:
+    IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : octets{a, b, c, d} {}
+    uint8_t operator[](int index) const { return octets[index]; }
+    uint8_t &operator[](int index) { return octets[index]; }
+
+private:
+    uint8_t octets[4];
+};
+
+// one W5x00 hardware socket, the test feeds rx and inspects tx
+typedef struct MockSocket {
+    uint8_t rx[2048];
+    size_t rxLength;
+    size_t rxPosition;
+    uint8_t tx[65536];
+    size_t txLength;
+    uint32_t writeCalls; // number of write() calls, each one is an SPI burst on the target
+    bool connected;
+} MockSocket;
+
+void mockSocketReset(MockSocket &socket, const char *request = "");
+
+class EthernetClient : public Stream {
+public:
+    EthernetClient() : socket(nullptr) {}
+    explicit EthernetClient(MockSocket *mockSocket) : socket(mockSocket) {}
+
+    int available() override;
+    int read() override;
+    int read(uint8_t *buffer, size_t size);
+    int peek() override;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *data, size_t size) override;
+    using Print::write;
+    int availableForWrite() override;
+    void flush() override {}
+    void stop();
+    uint8_t connected();
+    explicit operator bool() const { return socket != nullptr; }
+    bool operator==(const EthernetClient &rhs) const { return socket == rhs.socket; }
+    bool operator!=(const EthernetClient &rhs) const { return socket != rhs.socket; }
+
+private:
+    MockSocket *socket;
+};
+
+class EthernetServer {
+public:
+    explicit EthernetServer(uint16_t port) : port(port), pending{}, pendingCount(0) {}
+    void begin() {}
+    EthernetClient available();
+    EthernetClient accept();
+    void mockConnect(MockSocket *socket); // queues a connection for the next accept()
+
+private:
+    uint16_t port;
+    MockSocket *pending[MAX_SOCK_NUM];
+    uint8_t pendingCount;
+};
+
+// keeps the last datagram sent and one queued reply, the test inspects and feeds them
+class EthernetUDP {
+public:
+    EthernetUDP() : tx{}, txLength(0), packets(0), rx{}, rxLength(0), rxPosition(0), rxPending(false) {}
+    uint8_t begin(uint16_t) { return 1; }
+    int beginPacket(const char *, uint16_t) { txLength = 0; return 1; }
+    int beginPacket(IPAddress, uint16_t) { txLength = 0; return 1; }
+    size_t write(const uint8_t *data, size_t size);
+    int endPacket() { packets++; return 1; }
+    int parsePacket();
+    int read(uint8_t *buffer, size_t size);
+    void mockReply(const uint8_t *data, size_t size);
+
+    uint8_t tx[64];
+    size_t txLength;
+    uint32_t packets; // datagrams sent
+
+private:
+    uint8_t rx[64];
+    size_t rxLength;
+    size_t rxPosition;
+    bool rxPending;
+};
+
+class EthernetClass {
+public:
+    static int begin(uint8_t *) { return 1; }
+    static IPAddress localIP() { return IPAddress(192, 168, 1, 2); }
+    static IPAddress dnsServerIP() { return IPAddress(192, 168, 1, 1); }
+};
+
+extern EthernetClass Ethernet;
+
+#endif //POWER_CONTROLLER_EVERY_NATIVE_ETHERNET_H
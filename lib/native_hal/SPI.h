@@ -0,0 +1,6 @@
+#ifndef POWER_CONTROLLER_EVERY_NATIVE_SPI_H
+#define POWER_CONTROLLER_EVERY_NATIVE_SPI_H
+
+#include <Arduino.h>
+
+#endif //POWER_CONTROLLER_EVERY_NATIVE_SPI_H
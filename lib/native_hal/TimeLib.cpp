@@ -0,0 +1,56 @@
+#include <TimeLib.h>
+
+static time_t baseTime = 0;
+static unsigned long baseMillis = 0;
+static timeStatus_t status = timeNotSet;
+
+time_t now() {
+    return baseTime + (time_t) ((millis() - baseMillis) / 1000);
+}
+
+void setTime(time_t t) {
+    baseTime = t;
+    baseMillis = millis();
+    status = timeSet;
+}
+
+void adjustTime(long adjustment) {
+    baseTime += adjustment;
+}
+
+timeStatus_t timeStatus() {
+    return status;
+}
+
+void setSyncProvider(getExternalTime getTimeFunction) {
+    time_t t = getTimeFunction();
+    if (t != 0) {
+        setTime(t);
+    }
+}
+
+void setSyncInterval(time_t) {
+}
+
+void breakTime(time_t time, tmElements_t &tm) {
+    struct tm parts{};
+    gmtime_r(&time, &parts);
+    tm.Second = parts.tm_sec;
+    tm.Minute = parts.tm_min;
+    tm.Hour = parts.tm_hour;
+    tm.Wday = parts.tm_wday + 1;
+    tm.Day = parts.tm_mday;
+    tm.Month = parts.tm_mon + 1;
+    tm.Year = parts.tm_year - 70;
+}
+
+time_t makeTime(const tmElements_t &tm) {
+    struct tm parts{};
+    parts.tm_sec = tm.Second;
+    parts.tm_min = tm.Minute;
+    parts.tm_hour = tm.Hour;
+    parts.tm_mday = tm.Day;
+    parts.tm_mon = tm.Month - 1;
+    parts.tm_year = tm.Year + 70;
+    return timegm(&parts);
+}
@@ -0,0 +1,38 @@
+//
+// Host stand-in for the TimeLib API, now() follows the mock clock set by the test
+//
+
+#ifndef POWER_CONTROLLER_EVERY_NATIVE_TIMELIB_H
+#define POWER_CONTROLLER_EVERY_NATIVE_TIMELIB_H
+
+#include <Arduino.h>
+#include <time.h>
+
+#define SECS_PER_MIN  ((time_t)(60UL))
+#define SECS_PER_HOUR ((time_t)(3600UL))
+#define SECS_PER_DAY  ((time_t)(SECS_PER_HOUR * 24UL))
+
+typedef enum {timeNotSet, timeNeedsSync, timeSet} timeStatus_t;
+
+typedef struct {
+    uint8_t Second;
+    uint8_t Minute;
+    uint8_t Hour;
+    uint8_t Wday;   // day of week, sunday is day 1
+    uint8_t Day;
+    uint8_t Month;
+    uint8_t Year;   // offset from 1970
+} tmElements_t;
+
+typedef time_t(*getExternalTime)();
+
+time_t now();
+void setTime(time_t t);
+void adjustTime(long adjustment);
+timeStatus_t timeStatus();
+void setSyncProvider(getExternalTime getTimeFunction);
+void setSyncInterval(time_t interval);
+void breakTime(time_t time, tmElements_t &tm);
+time_t makeTime(const tmElements_t &tm);
+
+#endif //POWER_CONTROLLER_EVERY_NATIVE_TIMELIB_H
@@ -0,0 +1,171 @@
+#include <ntp.h>
+
+static uint32_t readUint32(const uint8_t *data) {
+    return (uint32_t) data[0] << 24 | (uint32_t) data[1] << 16 | (uint32_t) data[2] << 8 | data[3];
+}
+
+// NTP fraction of a second to ms
+static uint16_t readFraction(const uint8_t *data) {
+    return (uint16_t) ((((uint32_t) data[0] << 8 | data[1]) * 1000) >> 16);
+}
+
+NtpClient::NtpClient(EthernetUDP &udp, const char *server, int32_t utcOffset) : udp(udp), server(server),
+        utcOffset(utcOffset), serverAddress(), resolved(false), failures(0), state(NTP_IDLE), requestTime(0),
+        nextSync(0), syncInterval(NTP_MIN_INTERVAL), lastRoundTrip(0), anchored(false), anchorMillis(0),
+        anchorSeconds(0), anchorFraction(0), driftKnown(false), driftPpm(0), settingTime(false), setTimeAt(0),
+        pendingTime(0), correctionStart(0), correctionApplied(0) {
+}
+
+void NtpClient::begin(uint16_t localPort) {
+    udp.begin(localPort);
+    nextSync = millis();
+}
+
+void NtpClient::update() {
+    uint32_t now = millis();
+    if (state == NTP_WAIT_REPLY) {
+        receiveReply();
+        if (state == NTP_WAIT_REPLY && now - requestTime > NTP_REPLY_TIMEOUT) {
+            state = NTP_IDLE;
+            if (++failures >= NTP_MAX_FAILURES) {
+                resolved = false;
+                failures = 0;
+            }
+            syncInterval = NTP_MIN_INTERVAL;
+            nextSync = now + NTP_RETRY_INTERVAL * 1000UL;
+#if NTP_OPTION_DEBUG
+            Serial.println("NTP reply timed out");
+#endif
+        }
+    } else if ((int32_t) (now - nextSync) >= 0) {
+        sendRequest();
+    }
+
+    if (settingTime && (int32_t) (millis() - setTimeAt) >= 0) {
+        settingTime = false;
+        setTime(pendingTime);
+        correctionStart = setTimeAt;
+        correctionApplied = 0;
+    } else if (!settingTime && driftKnown) {
+        correctDrift();
+    }
+}
+
+bool NtpClient::isSynced() const {
+    return anchored;
+}
+
+int32_t NtpClient::drift() const {
+    return driftPpm;
+}
+
+uint32_t NtpClient::interval() const {
+    return syncInterval;
+}
+
+uint16_t NtpClient::roundTrip() const {
+    return lastRoundTrip;
+}
+
+void NtpClient::sendRequest() {
+    if (!resolved) {
+        // the only blocking call, made once and again only after repeated lost replies
+        DNSClient dns;
+        dns.begin(EthernetClass::dnsServerIP());
+        resolved = dns.getHostByName(server, serverAddress) == 1;
+        if (!resolved) {
+            nextSync = millis() + NTP_RETRY_INTERVAL * 1000UL;
+            return;
+        }
+    }
+    while (udp.parsePacket() > 0); // discard any late replies
+
+    uint8_t packet[NTP_PACKET_SIZE] = {0};
+    packet[0] = 0b11100011; // LI, Version, Mode
+    packet[1] = 0; // Stratum, or type of clock
+    packet[2] = 6; // Polling Interval
+    packet[3] = 0xEC; // Peer Clock Precision
+    // 8 bytes of zero for Root Delay & Root Dispersion
+    packet[12] = 49;
+    packet[13] = 0x4E;
+    packet[14] = 49;
+    packet[15] = 52;
+    udp.beginPacket(serverAddress, NTP_PORT);
+    udp.write(packet, NTP_PACKET_SIZE);
+    udp.endPacket();
+    requestTime = millis();
+    state = NTP_WAIT_REPLY;
+}
+
+void NtpClient::receiveReply() {
+    if (udp.parsePacket() < NTP_PACKET_SIZE) {
+        return;
+    }
+    uint32_t receiveTime = millis();
+    uint8_t packet[NTP_PACKET_SIZE];
+    udp.read(packet, NTP_PACKET_SIZE);
+    state = NTP_IDLE;
+    failures = 0;
+
+    // time the server held the request, from its receive (32) and transmit (40) timestamps
+    uint32_t serverReceive = readUint32(packet + 32);
+    uint32_t serverTransmit = readUint32(packet + 40);
+    uint16_t transmitFraction = readFraction(packet + 44);
+    int32_t held = (int32_t) (serverTransmit - serverReceive) * 1000 + transmitFraction - readFraction(packet + 36);
+    int32_t roundTrip = (int32_t) (receiveTime - requestTime) - held;
+    lastRoundTrip = roundTrip < 0 ? 0 : roundTrip;
+
+    // the reply spent half the round trip on the way back
+    uint32_t fraction = transmitFraction + lastRoundTrip / 2;
+    uint32_t seconds = serverTransmit + fraction / 1000;
+    applyTime(receiveTime, seconds, fraction % 1000);
+}
+
+void NtpClient::applyTime(uint32_t receiveTime, uint32_t seconds, uint16_t fraction) {
+    updateDrift(receiveTime, seconds, fraction);
+
+    pendingTime = (time_t) (seconds - NTP_UNIX_OFFSET + utcOffset + 1);
+    setTimeAt = receiveTime + 1000 - fraction;
+    settingTime = true;
+    nextSync = receiveTime + syncInterval * 1000UL;
+#if NTP_OPTION_DEBUG
+    char buffer[64] = {0};
+    sprintf(buffer, "NTP rtt %u ms, drift %ld ppm, next in %lu s", lastRoundTrip, (long) driftPpm,
+            (unsigned long) syncInterval);
+    Serial.println(buffer);
+#endif
+}
+
+void NtpClient::updateDrift(uint32_t receiveTime, uint32_t seconds, uint16_t fraction) {
+    uint32_t localElapsed = receiveTime - anchorMillis;
+    if (anchored && localElapsed >= NTP_MIN_INTERVAL * 1000UL / 2 && localElapsed <= NTP_MAX_INTERVAL * 2000UL) {
+        int32_t ntpElapsed = (int32_t) (seconds - anchorSeconds) * 1000 + fraction - anchorFraction;
+        int32_t error = ntpElapsed - (int32_t) localElapsed;
+        int32_t predicted = (int32_t) ((int64_t) localElapsed * driftPpm / 1000000);
+        bool characterised = driftKnown && abs(error - predicted) <= NTP_TOLERANCE;
+
+        int32_t measured = (int32_t) ((int64_t) error * 1000000 / (int32_t) localElapsed);
+        driftPpm = driftKnown ? (3 * driftPpm + measured) / 4 : measured;
+        driftKnown = true;
+
+        syncInterval = characterised ? min(syncInterval * 2, (uint32_t) NTP_MAX_INTERVAL) : NTP_MIN_INTERVAL;
+    } else {
+        syncInterval = NTP_MIN_INTERVAL;
+    }
+    anchored = true;
+    anchorMillis = receiveTime;
+    anchorSeconds = seconds;
+    anchorFraction = fraction;
+}
+
+// TimeLib counts whole seconds of millis(), so the estimated error is fed in a second at a time
+void NtpClient::correctDrift() {
+    int32_t expected = (int32_t) ((int64_t) (millis() - correctionStart) * driftPpm / 1000000);
+    if (expected - correctionApplied >= 1000) {
+        adjustTime(1);
+        correctionApplied += 1000;
+    } else if (expected - correctionApplied <= -1000) {
+        adjustTime(-1);
+        correctionApplied -= 1000;
+    }
+}
@@ -0,0 +1,80 @@
+//
+// Non-blocking NTP client, sends a request and picks up the reply on later loop() passes
+//
+
+#ifndef POWER_CONTROLLER_EVERY_NTP_H
+#define POWER_CONTROLLER_EVERY_NTP_H
+
+#include <Arduino.h>
+#include <Ethernet.h>
+#include <Dns.h>
+#include <TimeLib.h>
+
+#define NTP_OPTION_DEBUG false
+
+#define NTP_PORT 123
+#define NTP_PACKET_SIZE 48
+#define NTP_UNIX_OFFSET 2208988800UL // seconds from 1900 to 1970
+
+#define NTP_REPLY_TIMEOUT 2000 // ms
+#define NTP_RETRY_INTERVAL 60 // s, until the first sync and after a lost reply
+#define NTP_MIN_INTERVAL 3600 // s
+#define NTP_MAX_INTERVAL 86400 // s, the interval doubles up to this once the drift estimate holds
+#define NTP_TOLERANCE 250 // ms, largest prediction error that still counts as characterised
+#define NTP_MAX_FAILURES 3 // lost replies before the server name is resolved again
+
+class NtpClient {
+public:
+    NtpClient(EthernetUDP &udp, const char *server, int32_t utcOffset);
+
+    void begin(uint16_t localPort);
+    void update(); // sends, receives and applies corrections, never waits
+
+    bool isSynced() const;
+    int32_t drift() const; // local oscillator error in ppm, positive when millis() runs slow
+    uint32_t interval() const; // s until the next regular sync
+    uint16_t roundTrip() const; // ms, of the last reply
+
+private:
+    enum NtpState : uint8_t {
+        NTP_IDLE,
+        NTP_WAIT_REPLY
+    };
+
+    EthernetUDP &udp;
+    const char *server;
+    int32_t utcOffset;
+    IPAddress serverAddress;
+    bool resolved;
+    uint8_t failures;
+    NtpState state;
+    uint32_t requestTime; // millis() when the request went out
+    uint32_t nextSync; // millis() of the next request
+    uint32_t syncInterval;
+    uint16_t lastRoundTrip;
+
+    // NTP time at the last reply, kept to measure the drift over the next interval
+    bool anchored;
+    uint32_t anchorMillis;
+    uint32_t anchorSeconds;
+    uint16_t anchorFraction; // ms
+    bool driftKnown;
+    int32_t driftPpm;
+
+    // the clock is set on the next second boundary so TimeLib keeps the sub-second phase
+    bool settingTime;
+    uint32_t setTimeAt;
+    time_t pendingTime;
+
+    // drift correction applied through adjustTime() since the clock was set
+    uint32_t correctionStart;
+    int32_t correctionApplied; // ms
+
+    void sendRequest();
+    void receiveReply();
+    void applyTime(uint32_t receiveTime, uint32_t seconds, uint16_t fraction);
+    void updateDrift(uint32_t receiveTime, uint32_t seconds, uint16_t fraction);
+    void correctDrift();
+};
+
+#endif //POWER_CONTROLLER_EVERY_NTP_H
@@ -0,0 +1,84 @@
+#include <persist.h>
+#include <EEPROM.h>
+
+Persistence::Persistence(uint16_t base, uint16_t length) : base(base), length(length), scanned(false), newest(0),
+        hasCheckpoint(false), sequence(0) {
+}
+
+uint8_t Persistence::slotCount() const {
+    uint16_t available = length != 0 ? length : EEPROM.length() - base;
+    return available / sizeof(PersistSlot);
+}
+
+uint16_t Persistence::address(uint8_t slot) const {
+    return base + slot * sizeof(PersistSlot);
+}
+
+uint16_t Persistence::crc16(const uint8_t *data, uint16_t length) {
+    uint16_t crc = 0xFFFF;
+    for (uint16_t i = 0; i < length; i++) {
+        crc ^= (uint16_t) data[i] << 8u;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = crc & 0x8000u ? (crc << 1u) ^ 0x1021u : crc << 1u;
+        }
+    }
+    return crc;
+}
+
+bool Persistence::readSlot(uint8_t slot, PersistSlot &record) const {
+    EEPROM.get(address(slot), record);
+    return record.version == PERSIST_VERSION &&
+           record.crc == crc16((const uint8_t *) &record, offsetof(PersistSlot, crc));
+}
+
+// the sequence numbers of the slots are consecutive, the signed difference finds the newest across the wrap-around
+void Persistence::scan() {
+    scanned = true;
+    hasCheckpoint = false;
+    PersistSlot record;
+    for (uint8_t slot = 0; slot < slotCount(); slot++) {
+        if (readSlot(slot, record) && (!hasCheckpoint || (int16_t) (record.sequence - sequence) > 0)) {
+            hasCheckpoint = true;
+            newest = slot;
+            sequence = record.sequence;
+        }
+    }
+}
+
+bool Persistence::restore(PersistentState &state) {
+    scan();
+    PersistSlot record;
+    if (!hasCheckpoint || !readSlot(newest, record)) {
+        return false;
+    }
+    state = record.state;
+#if PERSIST_OPTION_DEBUG
+    Serial.print("Restored checkpoint ");
+    Serial.println(sequence, DEC);
+#endif
+    return true;
+}
+
+bool Persistence::save(const PersistentState &state) {
+    if (slotCount() == 0) {
+        return false;
+    }
+    if (!scanned) {
+        scan();
+    }
+    PersistSlot record;
+    if (hasCheckpoint && readSlot(newest, record) && memcmp(&record.state, &state, sizeof(state)) == 0) {
+        return false;
+    }
+    memset(&record, 0, sizeof(record));
+    record.sequence = hasCheckpoint ? sequence + 1 : 0;
+    record.version = PERSIST_VERSION;
+    record.state = state;
+    record.crc = crc16((const uint8_t *) &record, offsetof(PersistSlot, crc));
+    uint8_t slot = hasCheckpoint ? (newest + 1) % slotCount() : 0;
+    EEPROM.put(address(slot), record);
+    hasCheckpoint = true;
+    newest = slot;
+    sequence = record.sequence;
+    return true;
+}
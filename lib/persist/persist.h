@@ -0,0 +1,75 @@
+//
+// Wear-levelled checkpoints of the state that has to survive a reset, kept in EEPROM
+//
+// The EEPROM is used as a ring of fixed size slots. Every checkpoint goes into the slot after the newest one, so the
+// writes are spread evenly over all slots. A slot holds a sequence number, the layout version, the state and a CRC
+// over all of it; restore() picks the valid slot with the highest sequence number, so a write torn by a reset only
+// loses the checkpoint that was being written.
+//
+
+#ifndef POWER_CONTROLLER_EVERY_PERSIST_H
+#define POWER_CONTROLLER_EVERY_PERSIST_H
+
+#include <Arduino.h>
+#include <bms.h>
+
+#define PERSIST_OPTION_DEBUG false
+
+// bump whenever PersistentState changes, checkpoints of another layout are ignored
+#define PERSIST_VERSION 2
+
+#define PERSIST_PACKS 2 // packs of the battery bank with a checkpoint
+
+typedef struct PackCheckpoint {
+    uint8_t faultCounts[NUM_FAULTS];
+    float minVoltage24;
+    float maxVoltage24;
+    float maxCharge24;
+    float maxDischarge24;
+} PackCheckpoint;
+
+typedef struct PersistentState {
+    PackCheckpoint packs[PERSIST_PACKS];
+    uint8_t relays; // bit n is set when port n is on
+} PersistentState;
+
+typedef struct PersistSlot {
+    uint16_t sequence;
+    uint8_t version;
+    PersistentState state;
+    uint16_t crc; // CRC-16/CCITT of everything before it
+} PersistSlot;
+
+#define PERSIST_MIN_SLOTS 4 // of the 256 B EEPROM, fewer would wear the slots out too fast
+
+#ifdef __AVR__
+// no padding on AVR, a slot is 6 bytes plus (NUM_FAULTS + 16) per pack, 64 bytes with 13 faults and two packs
+static_assert(sizeof(PersistSlot) * PERSIST_MIN_SLOTS <= 256, "a checkpoint slot no longer fits the EEPROM often enough");
+#endif
+
+class Persistence {
+public:
+    // uses length bytes of EEPROM from base, the whole EEPROM by default
+    explicit Persistence(uint16_t base = 0, uint16_t length = 0);
+
+    bool restore(PersistentState &state); // loads the newest valid checkpoint, false if there is none
+    bool save(const PersistentState &state); // writes a checkpoint unless it equals the newest one, true if written
+
+    uint8_t slotCount() const;
+
+    static uint16_t crc16(const uint8_t *data, uint16_t length);
+
+private:
+    uint16_t base;
+    uint16_t length;
+    bool scanned;
+    uint8_t newest; // slot of the newest valid checkpoint
+    bool hasCheckpoint;
+    uint16_t sequence; // sequence number of the newest checkpoint
+
+    void scan();
+    bool readSlot(uint8_t slot, PersistSlot &record) const;
+    uint16_t address(uint8_t slot) const;
+};
+
+#endif //POWER_CONTROLLER_EVERY_PERSIST_H
@@ -0,0 +1,70 @@
+#include <relay.h>
+
+RelayBank::RelayBank(uint8_t basePin) : basePin(basePin), ports{} {
+    for (RelayPort &port : ports) {
+        port.cycleDuration = RELAY_CYCLE_DURATION;
+    }
+}
+
+void RelayBank::begin() {
+    for (uint8_t i = 0; i < NUM_PORTS; i++) {
+        pinMode(basePin + i, OUTPUT);
+        ports[i].on = digitalRead(basePin + i) != HIGH;
+        ports[i].pending = false;
+    }
+}
+
+void RelayBank::update() {
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < NUM_PORTS; i++) {
+        // signed difference keeps working across the millis() rollover
+        if (ports[i].pending && (int32_t) (now - ports[i].actionTime) >= 0) {
+            ports[i].pending = false;
+            write(i, ports[i].pendingOn);
+        }
+    }
+}
+
+void RelayBank::set(uint8_t port, bool on) {
+    if (port >= NUM_PORTS) {
+        return;
+    }
+    ports[port].pending = false;
+    write(port, on);
+}
+
+void RelayBank::schedule(uint8_t port, bool on, uint32_t delay) {
+    if (port >= NUM_PORTS) {
+        return;
+    }
+    ports[port].pending = true;
+    ports[port].pendingOn = on;
+    ports[port].actionTime = millis() + delay;
+}
+
+void RelayBank::cycle(uint8_t port) {
+    if (port >= NUM_PORTS) {
+        return;
+    }
+    write(port, false);
+    schedule(port, true, ports[port].cycleDuration);
+}
+
+void RelayBank::setCycleDuration(uint8_t port, uint16_t duration) {
+    if (port < NUM_PORTS) {
+        ports[port].cycleDuration = duration;
+    }
+}
+
+bool RelayBank::isOn(uint8_t port) const {
+    return port < NUM_PORTS && ports[port].on;
+}
+
+bool RelayBank::isCycling(uint8_t port) const {
+    return port < NUM_PORTS && ports[port].pending && ports[port].pendingOn && !ports[port].on;
+}
+
+void RelayBank::write(uint8_t port, bool on) {
+    ports[port].on = on;
+    digitalWrite(basePin + port, on ? LOW : HIGH);
+}
@@ -0,0 +1,46 @@
+//
+// Power port relays with pending timed actions, serviced from loop() instead of blocking in delay()
+//
+
+#ifndef POWER_CONTROLLER_EVERY_RELAY_H
+#define POWER_CONTROLLER_EVERY_RELAY_H
+
+#include <Arduino.h>
+
+#define NUM_PORTS 4
+
+// off time of a power cycle in ms, per port override with setCycleDuration()
+#define RELAY_CYCLE_DURATION 1000
+
+typedef struct RelayPort {
+    bool on;
+    bool pending; // a timed action is waiting for actionTime
+    bool pendingOn; // state the pending action switches to
+    uint32_t actionTime; // millis() at which the pending action runs
+    uint16_t cycleDuration;
+} RelayPort;
+
+// the relay module switches a port on when its pin is driven LOW
+class RelayBank {
+public:
+    explicit RelayBank(uint8_t basePin);
+
+    void begin(); // configures the pins and picks up the current relay states
+    void update(); // runs pending actions that are due, call every loop() pass
+
+    void set(uint8_t port, bool on); // switches immediately and cancels a pending action
+    void schedule(uint8_t port, bool on, uint32_t delay); // switches after delay ms
+    void cycle(uint8_t port); // off now, on again after the port's cycle duration
+    void setCycleDuration(uint8_t port, uint16_t duration);
+
+    bool isOn(uint8_t port) const;
+    bool isCycling(uint8_t port) const;
+
+private:
+    uint8_t basePin;
+    RelayPort ports[NUM_PORTS];
+
+    void write(uint8_t port, bool on);
+};
+
+#endif //POWER_CONTROLLER_EVERY_RELAY_H
@@ -0,0 +1,74 @@
+//
+// Fixed capacity ring buffer with O(1) append, iterates oldest to newest and never yields unfilled slots
+//
+
+#ifndef POWER_CONTROLLER_EVERY_RINGBUFFER_H
+#define POWER_CONTROLLER_EVERY_RINGBUFFER_H
+
+#include <stdint.h>
+
+template<typename T, uint16_t Capacity>
+class RingBuffer {
+public:
+    class const_iterator {
+    public:
+        const_iterator(const RingBuffer *buffer, uint16_t position) : buffer(buffer), position(position) {}
+        const T &operator*() const { return (*buffer)[position]; }
+        const T *operator->() const { return &(*buffer)[position]; }
+        const_iterator &operator++() { position++; return *this; }
+        bool operator==(const const_iterator &rhs) const { return position == rhs.position; }
+        bool operator!=(const const_iterator &rhs) const { return position != rhs.position; }
+
+    private:
+        const RingBuffer *buffer;
+        uint16_t position; // logical position, 0 is the oldest record
+    };
+
+    RingBuffer() : head(0), count(0) {}
+
+    // appends a record, overwriting the oldest one when full
+    void push(const T &value) {
+        records[head] = value;
+        head = head + 1 == Capacity ? 0 : head + 1;
+        if (count < Capacity) {
+            count++;
+        }
+    }
+
+    // drops the oldest record
+    void pop() {
+        if (count > 0) {
+            count--;
+        }
+    }
+
+    void clear() {
+        head = 0;
+        count = 0;
+    }
+
+    uint16_t size() const { return count; }
+    bool isEmpty() const { return count == 0; }
+    bool isFull() const { return count == Capacity; }
+    static constexpr uint16_t capacity() { return Capacity; }
+
+    // index 0 is the oldest record, size() - 1 the newest
+    const T &operator[](uint16_t index) const { return records[physical(index)]; }
+    T &operator[](uint16_t index) { return records[physical(index)]; }
+    const T &newest() const { return (*this)[count - 1]; }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, count); }
+
+private:
+    T records[Capacity]{};
+    uint16_t head;  // next slot to write
+    uint16_t count;
+
+    uint16_t physical(uint16_t index) const {
+        uint16_t slot = head + Capacity - count + index;
+        return slot >= Capacity ? slot - Capacity : slot;
+    }
+};
+
+#endif //POWER_CONTROLLER_EVERY_RINGBUFFER_H
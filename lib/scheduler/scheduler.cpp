@@ -0,0 +1,83 @@
+#include <scheduler.h>
+
+// signed difference keeps the order right across the millis() rollover
+static bool isBefore(uint32_t a, uint32_t b) {
+    return (int32_t) (a - b) < 0;
+}
+
+Scheduler::Scheduler() : tasks{}, order{}, count(0) {
+}
+
+int8_t Scheduler::add(const char *name, TaskFunction function, uint32_t period, TaskPolicy policy, uint32_t delay) {
+    if (count == SCHEDULER_MAX_TASKS) {
+        return -1;
+    }
+    Task &task = tasks[count];
+    task.name = name;
+    task.function = function;
+    task.period = period > 0 ? period : 1;
+    task.deadline = millis() + delay;
+    task.policy = policy;
+    task.stats = TaskStats{};
+    order[count] = count;
+    count++;
+    sort();
+    return (int8_t) (count - 1);
+}
+
+void Scheduler::defer(int8_t task, uint32_t delay) {
+    if (task < 0 || task >= count) {
+        return;
+    }
+    tasks[task].deadline = millis() + delay;
+    sort();
+}
+
+void Scheduler::update() {
+    // every task gets at most one turn per pass, so a task catching up cannot starve loop()
+    for (uint8_t turn = 0; turn < count; turn++) {
+        Task &task = tasks[order[0]];
+        uint32_t lateness = millis() - task.deadline;
+        if ((int32_t) lateness < 0) {
+            return;
+        }
+
+        if (task.policy == SKIP && task.period > 0 && lateness >= task.period) {
+            uint32_t missed = lateness / task.period;
+            task.stats.skipped += missed;
+            task.deadline += missed * task.period;
+        }
+        task.deadline += task.period;
+        sort();
+
+        uint32_t start = micros();
+        task.function();
+        uint32_t duration = micros() - start;
+
+        task.stats.runs++;
+        task.stats.lastDuration = duration;
+        task.stats.maxDuration = max(task.stats.maxDuration, duration);
+        task.stats.maxLateness = max(task.stats.maxLateness, lateness);
+    }
+}
+
+uint8_t Scheduler::size() const {
+    return count;
+}
+
+const Task &Scheduler::operator[](uint8_t task) const {
+    return tasks[task];
+}
+
+// insertion sort, the table is short and at most one entry is out of place
+void Scheduler::sort() {
+    for (uint8_t i = 1; i < count; i++) {
+        uint8_t id = order[i];
+        uint8_t j = i;
+        while (j > 0 && isBefore(tasks[id].deadline, tasks[order[j - 1]].deadline)) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = id;
+    }
+}
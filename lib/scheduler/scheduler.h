@@ -0,0 +1,57 @@
+//
+// Cooperative scheduler for loop(), tasks run once their millis() deadline has passed, earliest deadline first
+//
+
+#ifndef POWER_CONTROLLER_EVERY_SCHEDULER_H
+#define POWER_CONTROLLER_EVERY_SCHEDULER_H
+
+#include <Arduino.h>
+
+#define SCHEDULER_MAX_TASKS 8
+
+// what happens to periods that passed while a task was late
+enum TaskPolicy : uint8_t {
+    CATCH_UP, // every missed period still runs, back to back until the task is on time again
+    SKIP // the task runs once and its next deadline moves to the next period still ahead
+};
+
+typedef void (*TaskFunction)();
+
+typedef struct TaskStats {
+    uint32_t runs;
+    uint32_t skipped; // periods dropped by the SKIP policy
+    uint32_t maxLateness; // ms past the deadline
+    uint32_t lastDuration; // µs
+    uint32_t maxDuration; // µs
+} TaskStats;
+
+typedef struct Task {
+    const char *name;
+    TaskFunction function;
+    uint32_t period; // ms
+    uint32_t deadline; // millis()
+    TaskPolicy policy;
+    TaskStats stats;
+} Task;
+
+class Scheduler {
+public:
+    Scheduler();
+
+    // returns the task id, or -1 once SCHEDULER_MAX_TASKS are registered
+    int8_t add(const char *name, TaskFunction function, uint32_t period, TaskPolicy policy, uint32_t delay = 0);
+    void defer(int8_t task, uint32_t delay); // next run delay ms from now, also valid from inside the task
+    void update(); // runs the tasks that are due, an idle pass is one comparison
+
+    uint8_t size() const;
+    const Task &operator[](uint8_t task) const;
+
+private:
+    Task tasks[SCHEDULER_MAX_TASKS];
+    uint8_t order[SCHEDULER_MAX_TASKS]; // task ids, earliest deadline first
+    uint8_t count;
+
+    void sort();
+};
+
+#endif //POWER_CONTROLLER_EVERY_SCHEDULER_H
@@ -0,0 +1,32 @@
+#include <timing.h>
+
+static const char *const timingNames[NUM_TIMINGS] = {"loop", "handleHttpRequest", "bms.poll", "measureAndLogSensors",
+                                                     "ntp.update"};
+
+void recordTiming(TimingHistogram &histogram, uint32_t duration) {
+    histogram.count++;
+    if (duration > histogram.max) {
+        histogram.max = duration;
+    }
+    uint16_t &bucket = histogram.buckets[timingBucket(duration)];
+    if (bucket == UINT16_MAX) {
+        // the loop fills a bucket within minutes, saturating it would flatten the peak of the distribution
+        for (uint16_t &other : histogram.buckets) {
+            other /= 2;
+        }
+    }
+    bucket++;
+}
+
+uint8_t timingBucket(uint32_t duration) {
+    if (duration == 0) {
+        return 0;
+    }
+    // index of the highest set bit, unsigned long is 32 bits on the target but 64 on the host
+    uint8_t bucket = sizeof(unsigned long) * 8 - 1 - __builtin_clzl(duration);
+    return bucket < TIMING_BUCKETS ? bucket : TIMING_BUCKETS - 1;
+}
+
+const char *timingName(uint8_t point) {
+    return point < NUM_TIMINGS ? timingNames[point] : "";
+}
@@ -0,0 +1,43 @@
+//
+// Execution time histograms in µs with log2 buckets, fixed size and cheap enough to stay enabled
+//
+
+#ifndef POWER_CONTROLLER_EVERY_TIMING_H
+#define POWER_CONTROLLER_EVERY_TIMING_H
+
+#include <Arduino.h>
+
+// bucket i counts durations in [2^i, 2^(i+1)) µs, the last one everything from 2^23 µs (8.4 s) up
+#define TIMING_BUCKETS 24
+
+enum TimingPoint : uint8_t {
+    TIMING_LOOP,
+    TIMING_HTTP,
+    TIMING_BMS_POLL,
+    TIMING_SENSORS,
+    TIMING_NTP,
+    NUM_TIMINGS
+};
+
+typedef struct TimingHistogram {
+    uint32_t count;
+    uint32_t max; // µs
+    uint16_t buckets[TIMING_BUCKETS]; // all halved when one is full, the proportions stay while count keeps the total
+} TimingHistogram;
+
+void recordTiming(TimingHistogram &histogram, uint32_t duration);
+uint8_t timingBucket(uint32_t duration);
+const char *timingName(uint8_t point);
+
+// records the time until the end of the enclosing scope
+class TimingScope {
+public:
+    explicit TimingScope(TimingHistogram &histogram) : histogram(histogram), start(micros()) {}
+    ~TimingScope() { recordTiming(histogram, micros() - start); }
+
+private:
+    TimingHistogram &histogram;
+    uint32_t start;
+};
+
+#endif //POWER_CONTROLLER_EVERY_TIMING_H
@@ -0,0 +1,59 @@
+#include <connections.h>
+
+ConnectionTable::ConnectionTable(RequestHandler handler) : connections{}, handler(handler), next(0) {
+}
+
+void ConnectionTable::update(EthernetServer &server) {
+    accept(server);
+    for (uint8_t i = 0; i < HTTP_MAX_CONNECTIONS; i++) {
+        step(connections[(next + i) % HTTP_MAX_CONNECTIONS]);
+    }
+    next = (next + 1) % HTTP_MAX_CONNECTIONS;
+}
+
+uint8_t ConnectionTable::openConnections() {
+    uint8_t count = 0;
+    for (Connection &connection : connections) {
+        if (connection.client) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void ConnectionTable::accept(EthernetServer &server) {
+    EthernetClient client = server.accept();
+    while (client) {
+        Connection *free = nullptr;
+        for (Connection &connection : connections) {
+            if (!connection.client) {
+                free = &connection;
+                break;
+            }
+        }
+        if (free == nullptr) {
+            // all slots busy, the client retries once a socket is released
+            client.stop();
+            return;
+        }
+        free->client = client;
+        free->parser.begin();
+        client = server.accept();
+    }
+}
+
+void ConnectionTable::step(Connection &connection) {
+    if (!connection.client || !connection.parser.update(connection.client)) {
+        return;
+    }
+    if (connection.parser.isComplete()) {
+        handler(connection.client, connection.parser.request());
+    }
+#if WEB_OPTION_DEBUG
+    if (connection.parser.hasTimedOut()) {
+        Serial.println("HTTP request timed out");
+    }
+#endif
+    connection.client.flush();
+    connection.client.stop();
+}
@@ -0,0 +1,40 @@
+//
+// Table of open HTTP connections, every connection owns a parser and is advanced round-robin from loop()
+//
+
+#ifndef POWER_CONTROLLER_EVERY_CONNECTIONS_H
+#define POWER_CONTROLLER_EVERY_CONNECTIONS_H
+
+#include <web.h>
+#include <parser.h>
+
+// the W5100 has 4 sockets whatever MAX_SOCK_NUM says, one of them stays free for the NTP UDP socket; a connection
+// is about 130 bytes of RAM
+#ifndef HTTP_MAX_CONNECTIONS
+#define HTTP_MAX_CONNECTIONS 3
+#endif
+
+typedef void (*RequestHandler)(EthernetClient &client, const Request &request);
+
+typedef struct Connection {
+    EthernetClient client;
+    RequestParser parser;
+} Connection;
+
+class ConnectionTable {
+public:
+    explicit ConnectionTable(RequestHandler handler);
+
+    void update(EthernetServer &server); // accepts new clients, then gives every open connection one step
+    uint8_t openConnections();
+
+private:
+    Connection connections[HTTP_MAX_CONNECTIONS];
+    RequestHandler handler;
+    uint8_t next; // connection stepped first on the next pass
+
+    void accept(EthernetServer &server);
+    void step(Connection &connection);
+};
+
+#endif //POWER_CONTROLLER_EVERY_CONNECTIONS_H
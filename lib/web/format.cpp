@@ -0,0 +1,37 @@
+#include <format.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+static const uint32_t powersOfTen[] = {1, 10, 100, 1000, 10000, 100000};
+
+char *formatFixed(char *buffer, int32_t value, uint8_t decimals) {
+    if (decimals > 5) {
+        decimals = 5;
+    }
+    const char *sign = value < 0 ? "-" : "";
+    uint32_t magnitude = value < 0 ? -(uint32_t) value : (uint32_t) value;
+    uint32_t scale = powersOfTen[decimals];
+    if (decimals == 0) {
+        sprintf(buffer, "%s%lu", sign, (unsigned long) magnitude);
+    } else {
+        sprintf(buffer, "%s%lu.%0*lu", sign, (unsigned long) (magnitude / scale), decimals, (unsigned long) (magnitude % scale));
+    }
+    return buffer;
+}
+
+char *formatFloat(char *buffer, float value, uint8_t decimals) {
+    if (isnan(value)) {
+        strcpy(buffer, "nan");
+        return buffer;
+    }
+    if (decimals > 5) {
+        decimals = 5;
+    }
+    float scaled = value * (float) powersOfTen[decimals];
+    if (scaled >= 2147483647.0f || scaled <= -2147483647.0f) {
+        strcpy(buffer, "ovf");
+        return buffer;
+    }
+    return formatFixed(buffer, (int32_t) (scaled < 0 ? scaled - 0.5f : scaled + 0.5f), decimals);
+}
@@ -0,0 +1,18 @@
+//
+// Heap free number formatting for the JSON printers, replaces String(value).c_str()
+//
+
+#ifndef POWER_CONTROLLER_EVERY_FORMAT_H
+#define POWER_CONTROLLER_EVERY_FORMAT_H
+
+#include <stdint.h>
+
+#define FORMAT_BUFFER_SIZE 16
+
+// value is fixed-point in units of 10^-decimals, e.g. formatFixed(buffer, -105, 2) gives "-1.05"
+char *formatFixed(char *buffer, int32_t value, uint8_t decimals = 2);
+
+// rounds to the given number of decimals, same output as String(value, decimals)
+char *formatFloat(char *buffer, float value, uint8_t decimals = 2);
+
+#endif //POWER_CONTROLLER_EVERY_FORMAT_H
@@ -101,7 +101,7 @@ char* pageBottom[] ={
         F(R"===(.then(data => {data["switches"].forEach((i, index) => {)==="),
         F(R"===(document.getElementById('n'.concat(index)).innerText = i["name"];)==="),
         F(R"===(document.getElementById('s'.concat(index)).className = i["state"] ? "alert-sm alert-success text-center" : "alert-sm alert-danger text-center";)==="),
-        F(R"===(document.getElementById('s'.concat(index)).innerText = i["state"] ? "On" : "Off";)==="),
+        F(R"===(document.getElementById('s'.concat(index)).innerText = i["state"] === "cycling" ? "Cycling" : i["state"] ? "On" : "Off";)==="),
         F(R"===(document.getElementById('i'.concat(index)).value = i["state"] ? "0" : "1";)==="),
         F(R"===(document.getElementById('b'.concat(index)).className = i["state"] ? "btn btn-block btn-danger" : "btn btn-block btn-success";)==="),
         F(R"===(document.getElementById('b'.concat(index)).innerText = i["state"] ? "Off" : "On";})}))==="),
@@ -0,0 +1,253 @@
+#include <parser.h>
+
+const char *requestQuery(const Request &request) {
+    return request.queryOffset != 0 ? request.url + request.queryOffset : "";
+}
+
+// value of the first parameter called name, nullptr if there is none
+static const char *queryParameter(const char *query, const char *name) {
+    size_t length = strlen(name);
+    while (*query != 0) {
+        if (strncmp(query, name, length) == 0 && query[length] == '=') {
+            return query + length + 1;
+        }
+        query = strchr(query, '&');
+        if (query == nullptr) {
+            break;
+        }
+        query++;
+    }
+    return nullptr;
+}
+
+bool queryValue(const char *query, const char *name, uint32_t &value) {
+    const char *parameter = queryParameter(query, name);
+    if (parameter == nullptr || !isdigit(*parameter)) {
+        return false;
+    }
+    value = strtoul(parameter, nullptr, 10);
+    return true;
+}
+
+bool queryEquals(const char *query, const char *name, const char *text) {
+    const char *parameter = queryParameter(query, name);
+    if (parameter == nullptr) {
+        return false;
+    }
+    size_t length = strlen(text);
+    return strncmp(parameter, text, length) == 0 && (parameter[length] == 0 || parameter[length] == '&');
+}
+
+RequestParser::RequestParser() : result{}, state(METHOD), header(OTHER_HEADER), timedOut(false), startTime(0), token{},
+                                 tokenLength(0), urlLength(0), contentLength(0), bodyRead(0), tagStarted(false) {
+}
+
+void RequestParser::begin() {
+    result = Request{};
+    // a POST without a valid powerN=M field switches nothing
+    result.powerPort = -1;
+    result.command = -1;
+    state = METHOD;
+    header = OTHER_HEADER;
+    timedOut = false;
+    startTime = millis();
+    tokenLength = 0;
+    token[0] = 0;
+    urlLength = 0;
+    contentLength = 0;
+    bodyRead = 0;
+    tagStarted = false;
+}
+
+bool RequestParser::update(EthernetClient &client) {
+    uint8_t chunk[32];
+    uint16_t budget = PARSER_READ_BUDGET;
+    while (state != COMPLETE && state != FAILED && budget > 0) {
+        int available = client.available();
+        if (available <= 0) {
+            break;
+        }
+        size_t length = min((size_t) available, sizeof(chunk));
+        length = min(length, (size_t) budget);
+        int received = client.read(chunk, length);
+        if (received <= 0) {
+            break;
+        }
+        consume(chunk, received);
+        budget -= received;
+    }
+
+    if (state != COMPLETE && state != FAILED) {
+        if (!client.connected()) {
+            state = FAILED;
+        } else if (millis() - startTime > REQUEST_TIMEOUT) {
+            timedOut = true;
+            state = FAILED;
+        }
+    }
+    return state == COMPLETE || state == FAILED;
+}
+
+void RequestParser::consume(const uint8_t *data, size_t length) {
+    for (size_t i = 0; i < length && state != COMPLETE && state != FAILED; i++) {
+        consume(data[i]);
+    }
+}
+
+bool RequestParser::isComplete() const {
+    return state == COMPLETE;
+}
+
+bool RequestParser::isFailed() const {
+    return state == FAILED;
+}
+
+bool RequestParser::hasTimedOut() const {
+    return timedOut;
+}
+
+const Request &RequestParser::request() const {
+    return result;
+}
+
+void RequestParser::consume(uint8_t c) {
+    switch (state) {
+        case METHOD:
+            if (c == ' ') {
+                endMethod();
+            } else if (c == '\r' || c == '\n' || tokenLength == PARSER_TOKEN_LENGTH) {
+                result.type = UNSUPPORTED;
+                state = COMPLETE;
+            } else {
+                appendToken(c);
+            }
+            break;
+        case URL:
+            if (c == ' ') {
+                state = VERSION;
+            } else if (c == '\n') {
+                state = HEADER_NAME;
+            } else if (c == '?' && result.queryOffset == 0 && urlLength < sizeof(result.url) - 1) {
+                // the path keeps its terminator, the query string is stored behind it
+                result.url[urlLength++] = 0;
+                result.url[urlLength] = 0;
+                result.queryOffset = urlLength;
+            } else if (c != '\r' && urlLength < sizeof(result.url) - 1) {
+                result.url[urlLength++] = c;
+                result.url[urlLength] = 0;
+            }
+            break;
+        case VERSION:
+            if (c == '\n') {
+                state = HEADER_NAME;
+            }
+            break;
+        case HEADER_NAME:
+            if (c == '\n') {
+                if (tokenLength == 0) {
+                    endHeaders();
+                }
+                tokenLength = 0;
+                token[0] = 0;
+            } else if (c == ':') {
+                endHeaderName();
+            } else if (c != '\r') {
+                appendToken((char) tolower(c));
+            }
+            break;
+        case HEADER_VALUE:
+            if (c == '\n') {
+                state = HEADER_NAME;
+            } else if (header == CONTENT_LENGTH && isdigit(c) && contentLength < 10000) {
+                contentLength = contentLength * 10 + (c - '0');
+            } else if (header == IF_NONE_MATCH) {
+                consumeTag(c);
+            }
+            break;
+        case BODY:
+            bodyRead++;
+            if (c == '&') {
+                endBodyField();
+            } else if (c != '\r' && c != '\n') {
+                appendToken(c);
+            }
+            if (bodyRead == contentLength) {
+                endBodyField();
+                state = COMPLETE;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void RequestParser::appendToken(char c) {
+    if (tokenLength < PARSER_TOKEN_LENGTH) {
+        token[tokenLength++] = c;
+        token[tokenLength] = 0;
+    }
+}
+
+void RequestParser::endMethod() {
+    if (strcmp(token, "GET") == 0) {
+        result.type = GET;
+    } else if (strcmp(token, "POST") == 0) {
+        result.type = POST;
+    } else {
+        result.type = UNSUPPORTED;
+        state = COMPLETE;
+        return;
+    }
+    tokenLength = 0;
+    token[0] = 0;
+    state = URL;
+}
+
+void RequestParser::endHeaderName() {
+    if (strcmp(token, "content-length") == 0) {
+        header = CONTENT_LENGTH;
+    } else if (strcmp(token, "if-none-match") == 0) {
+        header = IF_NONE_MATCH;
+    } else {
+        header = OTHER_HEADER;
+    }
+    tokenLength = 0;
+    token[0] = 0;
+    state = HEADER_VALUE;
+}
+
+// our ETags are 8 hex digits in quotes, only the first tag of a list is compared
+void RequestParser::consumeTag(char c) {
+    int8_t digit = -1;
+    if (c >= '0' && c <= '9') {
+        digit = c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+        digit = c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+        digit = c - 'A' + 10;
+    }
+    if (digit >= 0) {
+        tagStarted = true;
+        result.ifNoneMatch = result.ifNoneMatch << 4 | digit;
+    } else if (tagStarted) {
+        header = OTHER_HEADER;
+    }
+}
+
+void RequestParser::endHeaders() {
+    if (result.type == POST && contentLength > 0) {
+        state = BODY;
+    } else {
+        state = COMPLETE;
+    }
+}
+
+void RequestParser::endBodyField() {
+    // form field powerN=M, N is the port and M the command
+    if (strncmp(token, "power", 5) == 0 && isdigit(token[5]) && token[6] == '=' && isdigit(token[7])) {
+        result.powerPort = token[5] - '0';
+        result.command = token[7] - '0';
+    }
+    tokenLength = 0;
+    token[0] = 0;
+}
@@ -0,0 +1,76 @@
+//
+// Incremental HTTP request parser, consumes whatever the client has available on each call and never waits for more
+//
+
+#ifndef POWER_CONTROLLER_EVERY_PARSER_H
+#define POWER_CONTROLLER_EVERY_PARSER_H
+
+#include <web.h>
+
+// total time a client gets to deliver its request
+#ifndef REQUEST_TIMEOUT
+#define REQUEST_TIMEOUT 2000
+#endif
+
+// bytes consumed per update, bounds the time a single call spends on SPI reads
+#define PARSER_READ_BUDGET 256
+
+#define PARSER_TOKEN_LENGTH 20
+
+const char *requestQuery(const Request &request); // query string of the URL, empty if there was none
+bool queryValue(const char *query, const char *name, uint32_t &value); // unsigned decimal query parameter
+bool queryEquals(const char *query, const char *name, const char *text); // query parameter is present and equals text
+
+class RequestParser {
+public:
+    RequestParser();
+
+    void begin(); // call when a client connects, starts the request deadline
+    bool update(EthernetClient &client); // returns true once the request is complete or has failed
+    void consume(const uint8_t *data, size_t length);
+
+    bool isComplete() const;
+    bool isFailed() const;
+    bool hasTimedOut() const;
+    const Request &request() const;
+
+private:
+    enum ParseState : uint8_t {
+        METHOD,
+        URL,
+        VERSION,
+        HEADER_NAME,
+        HEADER_VALUE,
+        BODY,
+        COMPLETE,
+        FAILED
+    };
+
+    enum Header : uint8_t {
+        OTHER_HEADER,
+        CONTENT_LENGTH,
+        IF_NONE_MATCH
+    };
+
+    Request result;
+    ParseState state;
+    Header header;
+    bool timedOut;
+    uint32_t startTime;
+    char token[PARSER_TOKEN_LENGTH + 1]; // method, header name or body field
+    uint8_t tokenLength;
+    uint8_t urlLength;
+    uint16_t contentLength;
+    uint16_t bodyRead;
+    bool tagStarted; // first hex digit of the If-None-Match value seen
+
+    void consume(uint8_t c);
+    void appendToken(char c);
+    void endMethod();
+    void endHeaderName();
+    void consumeTag(char c);
+    void endHeaders();
+    void endBodyField();
+};
+
+#endif //POWER_CONTROLLER_EVERY_PARSER_H
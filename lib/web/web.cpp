@@ -0,0 +1,483 @@
+//
+// Page and JSON rendering, see web.h
+//
+
+#include <web.h>
+#include "page.h"
+#include <writer.h>
+#include <format.h>
+#include <parser.h>
+
+static bool endsWith(const char *text, const char *suffix) {
+    size_t textLength = strlen(text);
+    size_t suffixLength = strlen(suffix);
+    return suffixLength <= textLength && strcmp(text + textLength - suffixLength, suffix) == 0;
+}
+
+static uint8_t responseBuffer[WRITER_SEGMENT_SIZE];
+
+// wall clock time of the boot, keeps the ETags of different boots apart
+static uint32_t bootTime = 0;
+
+// ETag of the JSON resources that only change with new data, 0 for everything else and until the clock is set
+static uint32_t entityTag(const char *url) {
+    uint32_t generation;
+    uint32_t resource;
+    if (strcmp(url, "/sensors.json") == 0) {
+        generation = sensorData.generation();
+        resource = 1;
+    } else if (strcmp(url, "/battery.json") == 0) {
+        generation = battery.generation();
+        resource = 2;
+    } else if (strcmp(url, "/faults.json") == 0) {
+        generation = faultJournal.generation();
+        resource = 3;
+    } else {
+        return 0;
+    }
+    if (timeStatus() == timeNotSet) {
+        return 0;
+    }
+    if (bootTime == 0) {
+        bootTime = now() - millis() / 1000;
+    }
+    uint32_t tag = (bootTime ^ resource << 24) * 2654435761UL + generation;
+    return tag != 0 ? tag : 1;
+}
+
+static void printEntityTag(Print &client, uint32_t tag) {
+    char buffer[24] = {0};
+    sprintf(buffer, "ETag: \"%08lx\"", (unsigned long) tag);
+    client.println(buffer);
+    client.println(F("Cache-Control: no-cache"));
+}
+
+static void printResponse(Print &client, const char *url, int type, uint32_t ifNoneMatch, const char *query);
+
+static void printEnergy(Print &client);
+
+uint16_t printWebPage(EthernetClient client, const char *url, const int type, uint32_t ifNoneMatch, const char *query) {
+    BufferedWriter writer(client, responseBuffer, sizeof(responseBuffer));
+    printResponse(writer, url, type, ifNoneMatch, query);
+    writer.flush();
+#if WEB_OPTION_DEBUG
+    Serial.print(writer.bytesWritten());
+    Serial.print(" bytes in ");
+    Serial.print(writer.segments());
+    Serial.println(" segments");
+#endif
+    return writer.segments();
+}
+
+static void printResponse(Print &client, const char *url, const int type, uint32_t ifNoneMatch, const char *query) {
+    uint32_t tag = type == GET ? entityTag(url) : 0;
+    if (tag != 0 && tag == ifNoneMatch) {
+        client.println(F("HTTP/1.1 304 Not Modified"));
+        printEntityTag(client, tag);
+        client.println(F("Connection: close"));
+        client.println();
+        return;
+    }
+
+    //print header
+    if (type == POST) {
+        client.println("HTTP/1.1 303 See Other");
+        char buffer[64] = {0};
+        sprintf(buffer, "Location: http://%d.%d.%d.%d%s",EthernetClass::localIP()[0],EthernetClass::localIP()[1],
+                EthernetClass::localIP()[2],EthernetClass::localIP()[3],url);
+        Serial.println(buffer);
+        client.println(buffer);
+    } else {
+        client.println("HTTP/1.1 200 OK");
+        if(strcmp(url, "/") == 0){
+            char buffer[64] = {0};
+            sprintf(buffer, F("Refresh: 450; url=http://%d.%d.%d.%d%s"),EthernetClass::localIP()[0],
+                    EthernetClass::localIP()[1],EthernetClass::localIP()[2],EthernetClass::localIP()[3],url);
+            client.println(buffer);
+        }
+    }
+
+    if(endsWith(url, ".html")){
+        client.println(F("Content-Type: text/html"));
+    } else if(endsWith(url, ".json")){
+        client.println(F("Content-Type: application/json"));
+    }
+    if (tag != 0) {
+        printEntityTag(client, tag);
+    }
+    client.println(F("Connection: close"));
+    client.println();
+
+    if(strcmp(url, "/") == 0) {
+        printIndexPage(client);
+    } else if(strcmp(url, "/sensors.json") == 0){
+        printSensorsJson(client, query);
+    } else if(strcmp(url, "/battery.json") == 0){
+        printBatteryJson(client, query);
+    } else if(strcmp(url, "/faults.json") == 0){
+        printFaultsJson(client, query);
+    } else if(strcmp(url, "/switches.json") == 0){
+        printSwitchesJson(client);
+    } else if(strcmp(url, "/debug/timing.json") == 0){
+        printTimingJson(client);
+    }
+}
+
+static const char *switchState(uint8_t port) {
+    return relays.isCycling(port) ? R"===("cycling")===" : relays.isOn(port) ? "true" : "false";
+}
+
+void printSwitchesJson(Print &client) {
+    client.println(R"===({ "switches": [)===");
+    char buffer[64] = {0};
+    sprintf(buffer,R"===({"name": "Imaging Computer 1", "state": %s},)===", switchState(0));
+    client.println(buffer);
+    sprintf(buffer,R"===({"name": "Imaging Computer 2", "state": %s},)===", switchState(1));
+    client.println(buffer);
+    sprintf(buffer,R"===({"name": "Port 3", "state": %s},)===", switchState(2));
+    client.println(buffer);
+    sprintf(buffer,R"===({"name": "Port 4", "state": %s})===", switchState(3));
+    client.println(buffer);
+    client.println(R"===(]})===");
+}
+
+// histogram[i] counts runs that took [2^i, 2^(i+1)) µs
+void printTimingJson(Print &client) {
+    client.println(R"===({ "timings": [)===");
+    for(uint8_t i = 0; i < NUM_TIMINGS; i++){
+        char buffer[96] = {0};
+        sprintf(buffer, R"===({"name": "%s", "count": %lu, "maxUs": %lu, "histogram": [)===", timingName(i),
+                (unsigned long) timings[i].count, (unsigned long) timings[i].max);
+        client.print(buffer);
+        for(uint8_t bucket = 0; bucket < TIMING_BUCKETS; bucket++){
+            sprintf(buffer, bucket == 0 ? "%u" : ",%u", timings[i].buckets[bucket]);
+            client.print(buffer);
+        }
+        client.println(i != NUM_TIMINGS - 1 ? "]}," : "]}");
+    }
+    client.println("]}");
+}
+
+void printIndexPage(Print &client) {
+    for(auto line : pageTop){
+        client.println(line);
+    }
+    char buffer[265] = {0};
+    for(int i =0; i< NUM_PORTS; i++){
+        client.println(R"===(<tr>)===");
+        sprintf(buffer, R"===(<td class="align-middle" id="n%d"></td>)===", i);
+        client.println(buffer);
+        sprintf(buffer, R"===(<td class="align-middle"><div id="s%d"></div></td>)===", i);
+        client.println(buffer);
+        sprintf(buffer, R"===(<td class="align-middle"><form method="post"><input name="power%d" type="hidden" value="1" id="i%d"><button type="submit" id="b%d"></button></form></td>)===", i, i ,i);
+        client.println(buffer);
+        sprintf(buffer, R"===(<td class="align-middle"><form method="post"><input name="power%d" type="hidden" value="2"><button type="submit" class="btn btn-dark btn-block">Cycle</button></form></td>)===", i);
+        client.println(buffer);
+        sprintf(buffer, R"===(</tr>)===", i);
+        client.println(buffer);
+    }
+    for(auto line : pageBottom){
+        client.println(line);
+    }
+}
+
+static void printSensorTime(char *buffer, time_t time) {
+    tmElements_t elements;
+    breakTime(time, elements);
+    sprintf(buffer, R"===({"time":"%02d-%02d %02d:%02d", )===", elements.Month, elements.Day, elements.Hour, elements.Minute);
+}
+
+static void printSensorRecord(Print &client, const SensorData &record) {
+    char buffer[128] = {0};
+    char pressure[FORMAT_BUFFER_SIZE], temperature[FORMAT_BUFFER_SIZE], humidity[FORMAT_BUFFER_SIZE];
+    printSensorTime(buffer, record.readoutTime);
+    client.print(buffer);
+    sprintf(buffer, R"===("pressure":%s, "temp":%s, "humidity":%s})===",
+            formatFixed(pressure, record.pressure), formatFixed(temperature, record.temperature), formatFixed(humidity, record.humidity));
+    client.print(buffer);
+}
+
+static void printSensorRange(Print &client, const SensorRange &range) {
+    static const char *const names[SENSOR_CHANNELS] = {"pressure", "temp", "humidity"};
+    char buffer[128] = {0};
+    printSensorTime(buffer, range.time);
+    client.print(buffer);
+    for(uint8_t i = 0; i < SENSOR_CHANNELS; i++){
+        char value[FORMAT_BUFFER_SIZE], min[FORMAT_BUFFER_SIZE], max[FORMAT_BUFFER_SIZE];
+        sprintf(buffer, R"===("%s":%s, "%sMin":%s, "%sMax":%s%s)===", names[i], formatFixed(value, range.avg[i]),
+                names[i], formatFixed(min, range.min[i]), names[i], formatFixed(max, range.max[i]), i < 2 ? ", " : "}");
+        client.print(buffer);
+    }
+}
+
+// the closed slots of a tier that start within the bounds, then the slot that is still being filled
+template<uint16_t Records, uint32_t SlotSeconds>
+static void printSensorTier(Print &client, const SensorTier<Records, SlotSeconds> &tier, bool bounded, uint32_t since, uint32_t to) {
+    bool first = true;
+    for(uint16_t i = bounded ? tier.after(since) : 0; i < tier.size() && (uint32_t) tier.time(i) <= to; i++){
+        if(tier[i].count == 0){
+            continue;
+        }
+        if(!first) {
+            client.println(",");
+        }
+        first = false;
+        printSensorRange(client, decodeAggregate(tier[i], tier.time(i)));
+    }
+    const SensorSummary &open = tier.current();
+    if(open.count > 0 && (!bounded || (uint32_t) open.time > since) && (uint32_t) open.time <= to){
+        if(!first) {
+            client.println(",");
+        }
+        printSensorRange(client, summaryRange(open));
+    }
+}
+
+void printSensorsJson(Print &client, const char *query) {
+    uint32_t since = 0, from = 0, to = UINT32_MAX, step = 0;
+    bool bounded = queryValue(query, "since", since);
+    if(queryValue(query, "from", from) && from > 0){
+        since = bounded ? max(since, from - 1) : from - 1;
+        bounded = true;
+    }
+    queryValue(query, "to", to);
+    queryValue(query, "step", step);
+
+    // newest is what the client passes as since on its next poll
+    char buffer[48] = {0};
+    sprintf(buffer, R"===({ "newest": %lu, "values":[)===", sensorData.isEmpty() ? 0UL : (unsigned long) sensorData.newest().readoutTime);
+    client.println(buffer);
+
+    if(queryEquals(query, "res", "hour")){
+        printSensorTier(client, hourlySensorData, bounded, since, to);
+        client.println();
+        client.println("]}");
+        return;
+    }
+    if(queryEquals(query, "res", "day")){
+        printSensorTier(client, dailySensorData, bounded, since, to);
+        client.println();
+        client.println("]}");
+        return;
+    }
+
+    bool first = true;
+    SensorSummary summary{};
+    auto end = sensorData.end();
+    for(auto record = bounded ? sensorData.after(since) : sensorData.begin(); record != end && (uint32_t) record->readoutTime <= to; ++record){
+        if(step == 0){
+            if(!first) {
+                client.println(",");
+            }
+            first = false;
+            printSensorRecord(client, *record);
+            continue;
+        }
+        time_t stepStart = record->readoutTime - record->readoutTime % step;
+        if(summary.count > 0 && stepStart != summary.time){
+            if(!first) {
+                client.println(",");
+            }
+            first = false;
+            printSensorRange(client, summaryRange(summary));
+            summary = SensorSummary{};
+        }
+        summary.time = stepStart;
+        summary.add(*record);
+    }
+    if(summary.count > 0){
+        if(!first) {
+            client.println(",");
+        }
+        printSensorRange(client, summaryRange(summary));
+    }
+    client.println();
+    client.println("]}");
+}
+
+void printFaultsJson(Print &client, const char *query) {
+    uint32_t since = 0;
+    bool bounded = queryValue(query, "since", since);
+
+    // newest is what the client passes as since on its next poll; an event is about 70 characters of text, the time,
+    // the name and two numbers
+    char buffer[80 + FAULT_NAME_SIZE + 2 * FORMAT_BUFFER_SIZE] = {0};
+    snprintf(buffer, sizeof(buffer), R"===({ "newest": %lu, "events":[)===", faultJournal.size() == 0 ? 0UL :
+            (unsigned long) faultJournal[faultJournal.size() - 1].time);
+    client.println(buffer);
+
+    char name[FAULT_NAME_SIZE];
+    char voltage[FORMAT_BUFFER_SIZE];
+    char current[FORMAT_BUFFER_SIZE];
+    for(uint16_t i = bounded ? faultJournal.after(since) : 0; i < faultJournal.size(); i++){
+        const FaultEvent &event = faultJournal[i];
+        snprintf(buffer, sizeof(buffer), R"===({"time": %lu, "fault": "%s", "active": %s, "voltage": %s, "current": %s}%s)===",
+                (unsigned long) event.time, strcpy_P(name, faultName(event.fault & ~FAULT_EVENT_ACTIVE)),
+                event.fault & FAULT_EVENT_ACTIVE ? "true" : "false", formatFixed(voltage, event.voltage),
+                formatFixed(current, event.current), i != faultJournal.size() - 1 ? "," : "");
+        client.println(buffer);
+    }
+    client.println("]}");
+}
+
+void printBatteryJson(Print &client, const char *query) {
+    uint32_t pack = ALL_PACKS;
+    if (queryValue(query, "pack", pack) && pack >= battery.size()) {
+        client.println("{}");
+        return;
+    }
+    printCellVoltages(client, pack);
+    printBmsFaults(client, pack);
+    printBmsStates(client, pack);
+}
+
+// the bank reports the summed current, the lowest state of charge, the widest 24 h extremes and the hottest sensors
+// of the packs that are online; the 24 h currents are summed, an upper bound when the packs peaked at different times
+void printBmsStates(Print &client, uint8_t pack) {
+    float current, voltage, minVoltage, maxVoltage, maxCharge, maxDischarge, capacity, temp1, temp2;
+    uint8_t stateOfCharge;
+    if (pack == ALL_PACKS) {
+        current = battery.current();
+        voltage = battery.totalVoltage();
+        stateOfCharge = battery.stateOfCharge();
+        minVoltage = maxVoltage = maxCharge = maxDischarge = capacity = temp1 = temp2 = 0;
+        bool found = false;
+        for (uint8_t i = 0; i < battery.size(); i++) {
+            if (!battery.isOnline(i)) {
+                continue;
+            }
+            PackBMS &bms = battery[i];
+            minVoltage = found ? min(minVoltage, bms.minVoltage24()) : bms.minVoltage24();
+            maxVoltage = max(maxVoltage, bms.maxVoltage24());
+            maxCharge += bms.maxCharge24();
+            maxDischarge += bms.maxDischarge24();
+            capacity += bms.balanceCapacity;
+            temp1 = found ? max(temp1, bms.temperatures[0]) : bms.temperatures[0];
+            temp2 = found ? max(temp2, bms.temperatures[1]) : bms.temperatures[1];
+            found = true;
+        }
+    } else {
+        PackBMS &bms = battery[pack];
+        current = bms.current;
+        voltage = bms.totalVoltage;
+        stateOfCharge = bms.stateOfCharge;
+        minVoltage = bms.minVoltage24();
+        maxVoltage = bms.maxVoltage24();
+        maxCharge = bms.maxCharge24();
+        maxDischarge = bms.maxDischarge24();
+        capacity = bms.balanceCapacity;
+        temp1 = bms.temperatures[0];
+        temp2 = bms.temperatures[1];
+    }
+
+    char buffer[64] = {0};
+    char number[FORMAT_BUFFER_SIZE];
+    sprintf(buffer, R"===("charge": "%sA",)===", formatFloat(number, current < 0 ? 0 : current));
+    client.println(buffer);
+    sprintf(buffer, R"===("discharge": "%sA",)===", formatFloat(number, current < 0 ? -current : 0));
+    client.println(buffer);
+    sprintf(buffer, R"===("totalVoltage": "%sV",)===", formatFloat(number, voltage));
+    client.println(buffer);
+    sprintf(buffer, R"===("remainingSOC": %d,)===", stateOfCharge);
+    client.println(buffer);
+    sprintf(buffer, R"===("minVoltage": "%sV",)===", formatFloat(number, minVoltage));
+    client.println(buffer);
+    sprintf(buffer, R"===("maxVoltage": "%sV",)===", formatFloat(number, maxVoltage));
+    client.println(buffer);
+    sprintf(buffer, R"===("maxCharge": "%sA",)===", formatFloat(number, maxCharge));
+    client.println(buffer);
+    sprintf(buffer, R"===("maxDischarge": "%sA",)===", formatFloat(number, maxDischarge));
+    client.println(buffer);
+    sprintf(buffer, R"===("maxPower": "%sW",)===", formatFloat(number, capacity));
+    client.println(buffer);
+    sprintf(buffer, R"===("temp1": "%sC",)===", formatFloat(number, temp1));
+    client.println(buffer);
+    sprintf(buffer, R"===("temp2": "%sC",)===", formatFloat(number, temp2));
+    client.println(buffer);
+    if (pack != ALL_PACKS) {
+        sprintf(buffer, R"===("pack": %d, "online": %s)===", pack, battery.isOnline(pack) ? "true" : "false");
+        client.println(buffer);
+        client.println("}");
+        return;
+    }
+
+    uint8_t worstPack, worstCell;
+    float worstVoltage = battery.worstCellVoltage(worstPack, worstCell);
+    uint8_t online = 0;
+    for (uint8_t i = 0; i < battery.size(); i++) {
+        online += battery.isOnline(i) ? 1 : 0;
+    }
+    sprintf(buffer, R"===("worstCell": "%sV",)===", formatFloat(number, worstVoltage));
+    client.println(buffer);
+    sprintf(buffer, R"===("worstCellPack": %d, "worstCellNumber": %d,)===", worstPack, worstCell);
+    client.println(buffer);
+    sprintf(buffer, R"===("packs": %d, "packsOnline": %d,)===", battery.size(), online);
+    client.println(buffer);
+    sprintf(buffer, R"===("pollInterval": "%ss",)===", formatFixed(number, bmsPoller.interval() / 10, 2));
+    client.println(buffer);
+    printEnergy(client);
+    client.println("}");
+}
+
+// today's totals so far, then one entry per finished day
+static void printEnergy(Print &client) {
+    char buffer[112] = {0};
+    char charged[FORMAT_BUFFER_SIZE], discharged[FORMAT_BUFFER_SIZE], chargedWh[FORMAT_BUFFER_SIZE], dischargedWh[FORMAT_BUFFER_SIZE];
+    sprintf(buffer, R"===("chargedAh": %s, "dischargedAh": %s, "chargedWh": %s, "dischargedWh": %s,)===",
+            formatFixed(charged, energy.charged()), formatFixed(discharged, energy.discharged()),
+            formatFixed(chargedWh, energy.chargedWh(), 1), formatFixed(dischargedWh, energy.dischargedWh(), 1));
+    client.println(buffer);
+    client.println(R"===("energyHistory": [)===");
+    for(uint8_t i = 0; i < energy.days(); i++){
+        const EnergyDay &day = energy[i];
+        tmElements_t elements;
+        breakTime(day.day, elements);
+        sprintf(buffer, R"===({"day": "%04d-%02d-%02d", "chargedAh": %s, "dischargedAh": %s, "chargedWh": %u, "dischargedWh": %u}%s)===",
+                elements.Year + 1970, elements.Month, elements.Day, formatFixed(charged, day.charged),
+                formatFixed(discharged, day.discharged), day.chargedWh, day.dischargedWh, i != energy.days() - 1 ? "," : "");
+        client.println(buffer);
+    }
+    client.println("]");
+}
+
+// cells of the whole bank are labelled pack.cell
+void printCellVoltages(Print &client, uint8_t pack) {
+    client.println(R"===({ "cellVoltages":[)===");
+    uint8_t first = pack == ALL_PACKS ? 0 : pack;
+    uint8_t last = pack == ALL_PACKS ? battery.size() - 1 : pack;
+    char buffer[80] = {0};
+    char label[8];
+    char number[FORMAT_BUFFER_SIZE];
+    for(uint8_t p = first; p <= last; p++){
+        PackBMS &bms = battery[p];
+        for(uint8_t i = 0; i < bms.cellCount(); i++){
+            if(pack == ALL_PACKS && battery.size() > 1) {
+                sprintf(label, "%d.%d", p, i);
+            } else {
+                sprintf(label, "%d", i);
+            }
+            sprintf(buffer, R"===({"cell":"%s", "cellVoltage":%s, "balancing": %s})===", label,
+                    formatFloat(number, bms.cellVoltages[i]), bms.isBalancing(i) ? "true" : "false");
+            client.print(buffer);
+            client.println(p != last || i != bms.cellCount() - 1 ? "," : "");
+        }
+    }
+    client.println(R"===(],)===");
+}
+
+// the bank counts the faults of all packs
+void printBmsFaults(Print &client, uint8_t pack) {
+    client.println(R"===("faults": [)===");
+    char name[FAULT_NAME_SIZE];
+    char buffer[32 + FAULT_NAME_SIZE] = {0};
+    for(uint8_t i = 0; i < NUM_FAULTS; i++){
+        unsigned int count = 0;
+        for(uint8_t p = 0; p < battery.size(); p++){
+            count += pack == ALL_PACKS || pack == p ? battery[p].faultCounts[i] : 0;
+        }
+        sprintf(buffer,R"===({"fault": "%s", "count": %u}%s)===", strcpy_P(name, faultName(i)), count,
+                i != NUM_FAULTS - 1 ? "," : "");
+        client.println(buffer);
+    }
+    client.println(R"===(],)===");
+}
@@ -0,0 +1,93 @@
+//
+// HTTP request parsing and page/JSON rendering for the power controller
+//
+
+#ifndef POWER_CONTROLLER_EVERY_WEB_H
+#define POWER_CONTROLLER_EVERY_WEB_H
+
+#include <Arduino.h>
+#include <Ethernet.h>
+#include <TimeLib.h>
+#include <bms.h>
+#include <bank.h>
+#include <poller.h>
+#include <journal.h>
+#include <energy.h>
+#include <history.h>
+#include <archive.h>
+#include <relay.h>
+#include <timing.h>
+
+#define WEB_OPTION_DEBUG false
+
+#define GET 0
+#define POST 1
+#define UNSUPPORTED 2
+
+#define OFF 0
+#define ON 1
+#define CYCLE 2
+
+#define URL_LENGTH 64
+
+typedef struct Request{
+    int type;
+    char url[URL_LENGTH];
+    long powerPort;
+    long command;
+    uint32_t ifNoneMatch; // ETag the client already has, 0 for none
+    uint8_t queryOffset; // the query string follows the path's terminator in url, 0 for none
+} Request;
+
+const int numSensorRecords = 24 * 4; // a day of 15 minute slots, the tiers below keep the older records
+const int numSensorBlocks = 8;
+const int numHourlyRecords = 2 * 24; // two days of hourly min/avg/max, a week does not fit the SRAM
+const int numDailyRecords = 31; // a month of daily min/avg/max
+const uint8_t numPacks = 2; // in parallel
+const uint8_t numPackCells = 8;
+const uint8_t numPackTempSensors = 2;
+
+typedef BMS<numPackCells, numPackTempSensors> PackBMS;
+typedef PackBank<PackBMS, numPacks> BatteryBank;
+
+#define ALL_PACKS 0xFF // the bank as a whole
+
+// state rendered by the pages, owned by main.cpp (or the native test/benchmark)
+extern RelayBank relays;
+extern TimingHistogram timings[NUM_TIMINGS];
+extern SensorHistory<numSensorRecords, numSensorBlocks> sensorData;
+extern SensorTier<numHourlyRecords, 3600UL> hourlySensorData;
+extern SensorTier<numDailyRecords, 86400UL> dailySensorData;
+extern BatteryBank battery;
+extern AdaptivePoller bmsPoller;
+extern FaultJournal faultJournal;
+extern EnergyCounter energy;
+
+// renders the response for url through a BufferedWriter, returns the number of segments sent
+// a GET whose ifNoneMatch equals the resource's current ETag is answered with 304 and no body
+uint16_t printWebPage(EthernetClient client, const char *url, int type, uint32_t ifNoneMatch = 0, const char *query = "");
+
+// query parameter: pack=<n> for the detail of one pack, the whole bank otherwise
+void printBatteryJson(Print &client, const char *query = "");
+
+void printBmsFaults(Print &client, uint8_t pack = ALL_PACKS);
+
+void printCellVoltages(Print &client, uint8_t pack = ALL_PACKS);
+
+void printBmsStates(Print &client, uint8_t pack = ALL_PACKS);
+
+// query parameters: since=<epoch> for newer records only, from=<epoch> and to=<epoch> for a range and step=<seconds>
+// for the min/avg/max of the records in each step, res=hour or res=day for the archive tier instead of the 15 minute
+// records; since, from and to then apply to the start of the slots and step is ignored
+void printSensorsJson(Print &client, const char *query = "");
+
+// query parameter: since=<epoch> for newer events only
+void printFaultsJson(Print &client, const char *query = "");
+
+void printSwitchesJson(Print &client);
+
+void printIndexPage(Print &client);
+
+void printTimingJson(Print &client);
+
+#endif //POWER_CONTROLLER_EVERY_WEB_H
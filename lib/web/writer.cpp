@@ -0,0 +1,50 @@
+#include <writer.h>
+
+BufferedWriter::BufferedWriter(EthernetClient &client, uint8_t *buffer, uint16_t size) :
+        client(client), buffer(buffer), size(size), length(0), segmentCount(0), totalBytes(0) {
+}
+
+size_t BufferedWriter::write(uint8_t c) {
+    if (length == size) {
+        flush();
+    }
+    buffer[length++] = c;
+    totalBytes++;
+    return 1;
+}
+
+size_t BufferedWriter::write(const uint8_t *data, size_t count) {
+    size_t remaining = count;
+    while (remaining > 0) {
+        if (length == size) {
+            flush();
+        }
+        size_t chunk = (size_t) (size - length) < remaining ? (size_t) (size - length) : remaining;
+        memcpy(buffer + length, data, chunk);
+        length += chunk;
+        data += chunk;
+        remaining -= chunk;
+    }
+    totalBytes += count;
+    return count;
+}
+
+int BufferedWriter::availableForWrite() {
+    return size - length;
+}
+
+void BufferedWriter::flush() {
+    if (length > 0) {
+        client.write(buffer, length);
+        segmentCount++;
+        length = 0;
+    }
+}
+
+uint16_t BufferedWriter::segments() const {
+    return segmentCount;
+}
+
+uint32_t BufferedWriter::bytesWritten() const {
+    return totalBytes;
+}
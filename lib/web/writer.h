@@ -0,0 +1,39 @@
+//
+// Buffered Print wrapper for EthernetClient, coalesces the many small print/println calls of a response
+// into segment sized writes, each of which is one SPI burst to the W5x00 and usually one TCP segment
+//
+
+#ifndef POWER_CONTROLLER_EVERY_WRITER_H
+#define POWER_CONTROLLER_EVERY_WRITER_H
+
+#include <Arduino.h>
+#include <Ethernet.h>
+
+// default TCP MSS, can be raised up to 1460 (or the socket TX buffer) with a build flag if RAM allows
+#ifndef WRITER_SEGMENT_SIZE
+#define WRITER_SEGMENT_SIZE 536
+#endif
+
+class BufferedWriter : public Print {
+public:
+    BufferedWriter(EthernetClient &client, uint8_t *buffer, uint16_t size);
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *data, size_t size) override;
+    using Print::write;
+    int availableForWrite() override;
+    void flush() override; // sends whatever is buffered, call at the end of the response
+
+    uint16_t segments() const; // number of writes handed to the client so far
+    uint32_t bytesWritten() const;
+
+private:
+    EthernetClient &client;
+    uint8_t *buffer;
+    uint16_t size;
+    uint16_t length;
+    uint16_t segmentCount;
+    uint32_t totalBytes;
+};
+
+#endif //POWER_CONTROLLER_EVERY_WRITER_H
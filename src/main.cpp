@@ -7,62 +7,45 @@
 
 #include <SPI.h>
 #include <Ethernet.h>
-#include "page.h"
 #include <TimeLib.h>
 #define TINY_BME280_I2C
 #include <TinyBME280.h>
 #include <Wire.h>
 #include "bms.h"
-
-#define GET 0
-#define POST 1
-#define UNSUPPORTED 2
-
-#define OFF 0
-#define ON 1
-#define CYCLE 2
-
-#define NUM_PORTS 4
+#include "bank.h"
+#include "poller.h"
+#include "journal.h"
+#include "energy.h"
+#include "web.h"
+#include "connections.h"
+#include "ntp.h"
+#include "scheduler.h"
+#include "timing.h"
+#include "persist.h"
 
 #define DEBUG false
 
-typedef struct Request{
-    int type;
-    String url;
-    long powerPort;
-    long command;
-} Request;
-
-typedef struct SensorData{
-    time_t readoutTime;
-    float pressure;
-    float temperature;
-    float humidity;
-} SensorData;
-
-Request parseRequest(EthernetClient client);
+void handleHttpRequest(EthernetClient &client, const Request &request);
 
-void readAndLogRequestLines(EthernetClient client);
-
-void printWebPage(EthernetClient client, const String &url, int type);
+void measureAndLogSensors(time_t &now);
 
-void sendNtpPacket(const char * address);
+void logSensorsTask();
 
-void handleHttpRequest(EthernetClient &client);
+void pollBmsTask();
 
-time_t getNtpTime();
+void resetDailyStatisticsTask();
 
-void measureAndLogSensors(time_t &now);
+void updateNtpTask();
 
-void printBmsFaults(EthernetClient &client);
+void updateRelaysTask();
 
-void printCellVoltages(EthernetClient &client);
+void checkpointTask();
 
-void printBmsStates(EthernetClient &client);
+void restoreCheckpoint();
 
-void printSensorsJson(EthernetClient &client);
+void selectPack(uint8_t pack);
 
-void printIndexPage(EthernetClient &client);
+time_t clockSlot(int8_t task, time_t period);
 
 // Enter a MAC address and IP address for your controller below.
 // The IP address will be dependent on your local network:
@@ -72,32 +55,50 @@ byte mac[] = { 0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xED };
 // with the IP address and port you want to use
 // (port 80 is default for HTTP):
 EthernetServer server(80);
+ConnectionTable connections(handleHttpRequest);
 
 //NTP stuff
-#define 	NTP_OFFSET   3155673600
-#define 	UNIX_OFFSET   946684800
 const char ntpServer[] = "time.nist.gov";
-const int ntpPacketSize = 48;
-uint8_t packetBuffer[ntpPacketSize];
 const int timeZone = -8; //PST
 unsigned int localPort = 8888;
 EthernetUDP Udp;
+NtpClient ntp(Udp, ntpServer, timeZone * SECS_PER_HOUR);
+
+//periodic work, runs from loop() through the scheduler
+Scheduler scheduler;
+int8_t sensorTask;
+int8_t dailyTask;
+// wall clock tasks run within this many seconds of their slot, otherwise they only realign
+#define CLOCK_SLOT_TOLERANCE 60
+
+//execution time histograms, served on /debug/timing.json
+TimingHistogram timings[NUM_TIMINGS];
 
-//sensor data
-const int numSensorRecords = 24 * 4;
-SensorData sensorData[numSensorRecords];
-time_t lastSensorLogTime;
+//sensor data, 15 minute records and their hourly and daily consolidations
+SensorHistory<numSensorRecords, numSensorBlocks> sensorData;
+SensorTier<numHourlyRecords, 3600UL> hourlySensorData;
+SensorTier<numDailyRecords, 86400UL> dailySensorData;
 
-//variables for states
-bool ports[4] {false,false,false,false};
+//power port relays
 #define BASE_PORT_PIN 3
+RelayBank relays(BASE_PORT_PIN);
 
 //BME280
 tiny::BME280 bme;
 
-//Serial BMS connection
-BMS bms;
-time_t lastBmsCheckTime;
+//Serial BMS connections, both packs share Serial1 through a switch on PACK_SELECT_PIN
+#define PACK_SELECT_PIN 2
+BatteryBank battery;
+AdaptivePoller bmsPoller;
+FaultJournal faultJournal;
+EnergyCounter energy;
+int8_t bmsTask;
+
+//EEPROM checkpoints of the BMS statistics and relay states, restored on reset
+#define CHECKPOINT_INTERVAL (15 * 60 * 1000UL)
+#define CHECKPOINT_DELAY 10000UL // ms after a relay change, the changes within it share one write
+Persistence persistence;
+int8_t persistTask;
 
 #ifndef UNIT_TEST
 void setup() {
@@ -110,361 +111,182 @@ void setup() {
 #if DEBUG
     Serial.println(EthernetClass::localIP());
 #endif
-    //UDP for NTP
-    Udp.begin(localPort);
-    delay(2000);
-    setSyncProvider(getNtpTime);
-    setSyncInterval(SECS_PER_HOUR);
-#if DEBUG
-    if(timeStatus() != timeSet) Serial.println("Unable to sync with NTP");
-    Serial.println(now());
-#endif
+    //UDP for NTP, the first request goes out on the first loop() pass
+    ntp.begin(localPort);
     //relay module setup
-    pinMode(BASE_PORT_PIN, OUTPUT);
-    pinMode(BASE_PORT_PIN  + 1, OUTPUT);
-    pinMode(BASE_PORT_PIN + 2, OUTPUT);
-    pinMode(BASE_PORT_PIN +3, OUTPUT);
-    for(int i = BASE_PORT_PIN; i < BASE_PORT_PIN + NUM_PORTS; i++){
-        ports[i - BASE_PORT_PIN] = digitalRead(i) != HIGH;
-    }
-
-    //initialize sensor stuff below
-    memset(&sensorData, 0, sizeof(SensorData));
+    relays.begin();
 
     //bme280
     Wire.begin();
     bme.begin();
 
     //BMS
-    bms.begin(&Serial1);
-}
-
-void  loop() {
-
-    // listen for incoming clients
-    EthernetClient client = server.available();
-    if (client) {
-        handleHttpRequest(client);
+    pinMode(PACK_SELECT_PIN, OUTPUT);
+    battery.setSelector(selectPack);
+    for (uint8_t i = 0; i < battery.size(); i++) {
+        battery.begin(i, &Serial1);
     }
 
-    time_t seconds = now();
-    if(seconds % 900 == 0 && seconds != lastSensorLogTime) {
-        measureAndLogSensors(seconds);
-        lastSensorLogTime = seconds;
-    }
+    restoreCheckpoint();
 
-    if(seconds % 30 == 0 && seconds != lastBmsCheckTime){
-        bms.poll();
-        lastBmsCheckTime = seconds;
-    }
+    sensorTask = scheduler.add("sensors", logSensorsTask, SENSOR_SLOT_SECONDS * 1000UL, SKIP);
+    // the period only applies after a failed cycle, a completed one sets the next poll from the pack's activity
+    bmsTask = scheduler.add("bms", pollBmsTask, BMS_POLL_INTERVAL, SKIP);
+    dailyTask = scheduler.add("daily", resetDailyStatisticsTask, SECS_PER_DAY * 1000UL, SKIP);
+    scheduler.add("ntp", updateNtpTask, 10, SKIP);
+    scheduler.add("relays", updateRelaysTask, 10, SKIP);
+    persistTask = scheduler.add("checkpoint", checkpointTask, CHECKPOINT_INTERVAL, SKIP, CHECKPOINT_INTERVAL);
+}
 
-    if(seconds % SECS_PER_DAY == 0){
-        bms.clear24Values();
-        bms.clearFaultCounts();
+void  loop() {
+    TimingScope timing(timings[TIMING_LOOP]);
+
+    connections.update(server);
+    // without a pack online there is nothing to journal, count or adapt the poll interval to
+    if (battery.update() && battery.anyOnline()) {
+        float current = battery.current();
+        float voltage = battery.totalVoltage();
+        ProtectionStatus status = battery.protectionStatus();
+        faultJournal.update(status, voltage, current, now());
+        energy.add(voltage, current, millis());
+        scheduler.defer(bmsTask, bmsPoller.update(current, voltage, status.isAnySet()));
     }
+    scheduler.update();
 }
 #endif
 
-void measureAndLogSensors(time_t &now) {
-    for(int i = 0; i < numSensorRecords - 1; i++){
-        sensorData[i] = sensorData[i + 1];
+// returns the slot of a wall clock task that is due now, or 0 before the first NTP sync and when the task has drifted
+// off its slot; either way the task's next run is moved onto the next multiple of period
+time_t clockSlot(int8_t task, time_t period) {
+    if (timeStatus() == timeNotSet) {
+        scheduler.defer(task, 1000);
+        return 0;
     }
-    sensorData[numSensorRecords - 1] = {now, bme.readFixedPressure() / 100.0, bme.readFixedTempC() / 100.0, bme.readFixedHumidity() / 1000.0}; // NOLINT(cppcoreguidelines-narrowing-conversions)
-
-#if DEBUG
-    char buffer[32] = {0};
-    sprintf(buffer, "%d, %s, %s, %s", sensorData[numSensorRecords - 1].readoutTime, String(sensorData[numSensorRecords - 1].pressure).c_str(),
-            String(sensorData[numSensorRecords - 1].temperature).c_str(), String(sensorData[numSensorRecords - 1].humidity).c_str());
-    Serial.println(buffer);
-#endif
+    time_t seconds = now();
+    time_t slot = (seconds + period / 2) / period * period;
+    scheduler.defer(task, (slot + period - seconds) * 1000UL);
+    // time_t is unsigned on the target
+    int32_t offset = (int32_t) (seconds - slot);
+    return offset >= -CLOCK_SLOT_TOLERANCE && offset <= CLOCK_SLOT_TOLERANCE ? slot : 0;
 }
 
-void handleHttpRequest(EthernetClient &client) {
-    if (client.available()) {
-        Request request = parseRequest(client);
-        switch (request.type) {
-            case GET:
-                printWebPage(client, request.url, GET);
-                break;
-            case POST:
-                switch(request.command){
-                    case OFF:
-                        ports[request.powerPort] = false;
-                        digitalWrite(request.powerPort + BASE_PORT_PIN, HIGH);
-                        break;
-                    case ON:
-                        ports[request.powerPort] = true;
-                        digitalWrite(request.powerPort + BASE_PORT_PIN, LOW);
-                        break;
-                    case CYCLE:
-                        ports[request.powerPort] = false;
-                        digitalWrite(request.powerPort + BASE_PORT_PIN, HIGH);
-                        delay(1000);
-                        ports[request.powerPort] = true;
-                        digitalWrite(request.powerPort + BASE_PORT_PIN, LOW);
-                        break;
-                    default:
-                        break;
-                }
-                printWebPage(client, "/", POST);
-            default:
-                break;
-        }
+void logSensorsTask() {
+    time_t slot = clockSlot(sensorTask, SENSOR_SLOT_SECONDS);
+    if (slot != 0) {
+        measureAndLogSensors(slot);
     }
-
-    delay(10);
-    client.stop();
 }
 
-Request parseRequest(EthernetClient client) {
-    Request result{};
+void pollBmsTask() {
+    TimingScope timing(timings[TIMING_BMS_POLL]);
+    battery.poll();
+}
 
-    String s = client.readStringUntil('\n');
-#if DEBUG
-    Serial.println(s);
-#endif
-    if(s.startsWith("GET")){
-        result.type = GET;
-        result.url = s.substring(4, s.lastIndexOf(' '));
-        readAndLogRequestLines(client);
-    } else if(s.startsWith("POST")){
-        result.type = POST;
-        readAndLogRequestLines(client);
-        if(client.available()){
-            s = client.readStringUntil('\n');
-            if(s.startsWith("power")){
-                result.powerPort=s.substring(5,6).toInt();
-                result.command=s.substring(7,8).toInt();
-            }
-        }
-    } else {
-        result.type = UNSUPPORTED;
-    }
-#if DEBUG
-    Serial.println(result.url);
-#endif
-    return result;
+void selectPack(uint8_t pack) {
+    digitalWrite(PACK_SELECT_PIN, pack & 1u ? HIGH : LOW);
 }
 
-void readAndLogRequestLines(EthernetClient client) {
-    while (client.available()) {
-        String s = client.readStringUntil('\n');
-#if DEBUG
-        Serial.println(s);
-#endif
-        if(s.equals(String('\r'))){
-            break;
-        }
+void resetDailyStatisticsTask() {
+    time_t slot = clockSlot(dailyTask, SECS_PER_DAY);
+    if (slot != 0) {
+        battery.clearFaultCounts();
+        energy.rollover(slot - SECS_PER_DAY);
     }
 }
 
-void printWebPage(EthernetClient client, const String &url, const int type) {
-    //print header
-    if (type == POST) {
-        client.println("HTTP/1.1 303 See Other");
-        char buffer[64] = {0};
-        sprintf(buffer, "Location: http://%d.%d.%d.%d%s",EthernetClass::localIP()[0],EthernetClass::localIP()[1],
-                EthernetClass::localIP()[2],EthernetClass::localIP()[3],url.c_str());
-        Serial.println(buffer);
-        client.println(buffer);
-    } else {
-        client.println("HTTP/1.1 200 OK");
-        if(url.equals("/")){
-            char buffer[64] = {0};
-            sprintf(buffer, F("Refresh: 450; url=http://%d.%d.%d.%d%s"),EthernetClass::localIP()[0],
-                    EthernetClass::localIP()[1],EthernetClass::localIP()[2],EthernetClass::localIP()[3],url.c_str());
-            client.println(buffer);
-        }
-    }
+void updateNtpTask() {
+    TimingScope timing(timings[TIMING_NTP]);
+    ntp.update();
+}
 
-    if(url.endsWith(".html")){
-        client.println(F("Content-Type: text/html"));
-    } else if(url.endsWith(".json")){
-        client.println(F("Content-Type: application/json"));
-    }
-    client.println(F("Connection: close"));
-    client.println();
-
-    if(url.equals("/")) {
-        printIndexPage(client);
-    } else if(url.equals("/sensors.json")){
-        printSensorsJson(client);
-    } else if(url.equals("/battery.json")){
-        printCellVoltages(client);
-        printBmsFaults(client);
-        printBmsStates(client);
-    } else if(url.equals("/switches.json")){
-        client.println(R"===({ "switches": [)===");
-        char buffer[64] = {0};
-        sprintf(buffer,R"===({"name": "Imaging Computer 1", "state": %s},)===", ports[0] ? "true" : "false");
-        client.println(buffer);
-        sprintf(buffer,R"===({"name": "Imaging Computer 2", "state": %s},)===", ports[1] ? "true" : "false");
-        client.println(buffer);
-        sprintf(buffer,R"===({"name": "Port 3", "state": %s},)===", ports[2] ? "true" : "false");
-        client.println(buffer);
-        sprintf(buffer,R"===({"name": "Port 4", "state": %s})===", ports[3] ? "true" : "false");
-        client.println(buffer);
-        client.println(R"===(]})===");
-    }
+void updateRelaysTask() {
+    relays.update();
 }
 
-void printIndexPage(EthernetClient &client) {
-    for(auto line : pageTop){
-        client.println(line);
+// only the bytes that differ from the slot's previous contents are written, an unchanged state writes nothing
+void checkpointTask() {
+    PersistentState state{};
+    for (uint8_t i = 0; i < min(battery.size(), PERSIST_PACKS); i++) {
+        PackCheckpoint &pack = state.packs[i];
+        memcpy(pack.faultCounts, battery[i].faultCounts, sizeof(pack.faultCounts));
+        pack.minVoltage24 = battery[i].minVoltage24();
+        pack.maxVoltage24 = battery[i].maxVoltage24();
+        pack.maxCharge24 = battery[i].maxCharge24();
+        pack.maxDischarge24 = battery[i].maxDischarge24();
     }
-    char buffer[265] = {0};
-    for(int i =0; i< NUM_PORTS; i++){
-        client.println(R"===(<tr>)===");
-        sprintf(buffer, R"===(<td class="align-middle" id="n%d"></td>)===", i);
-        client.println(buffer);
-        sprintf(buffer, R"===(<td class="align-middle"><div id="s%d"></div></td>)===", i);
-        client.println(buffer);
-        sprintf(buffer, R"===(<td class="align-middle"><form method="post"><input name="power%d" type="hidden" value="1" id="i%d"><button type="submit" id="b%d"></button></form></td>)===", i, i ,i);
-        client.println(buffer);
-        sprintf(buffer, R"===(<td class="align-middle"><form method="post"><input name="power%d" type="hidden" value="2"><button type="submit" class="btn btn-dark btn-block">Cycle</button></form></td>)===", i);
-        client.println(buffer);
-        sprintf(buffer, R"===(</tr>)===", i);
-        client.println(buffer);
-    }
-    for(auto line : pageBottom){
-        client.println(line);
+    for (uint8_t i = 0; i < NUM_PORTS; i++) {
+        // a port in a power cycle is stored as on, the state it returns to
+        state.relays |= relays.isOn(i) || relays.isCycling(i) ? 1u << i : 0;
     }
+    persistence.save(state);
 }
 
-void printSensorsJson(EthernetClient &client) {
-    client.println(R"===({ "values":[)===");
-    for(int i = 0; i < numSensorRecords; i++){
-        char buffer[128] = {0};
-        tmElements_t elements;
-        breakTime(sensorData[i].readoutTime,elements);
-        sprintf(buffer, R"===({"time":"%02d-%02d %02d:%02d", "pressure":%s, "temp":%s, "humidity":%s})===", elements.Month, elements.Day, elements.Hour, elements.Minute,
-                String(sensorData[i].pressure).c_str(), String(sensorData[i].temperature).c_str(), String(sensorData[i].humidity).c_str());
-        client.print(buffer);
-        if(i != numSensorRecords - 1) {
-            client.println(",");
-        } else {
-            client.println();
-        }
+void restoreCheckpoint() {
+    PersistentState state{};
+    if (!persistence.restore(state)) {
+        return;
     }
-    client.println("]}");
-}
-
-void printBmsStates(EthernetClient &client) {
-    char buffer[64] = {0};
-    sprintf(buffer, R"===("charge": "%sA",)===", String(bms.current < 0 ? 0 : bms.current).c_str());
-    client.println(buffer);
-    sprintf(buffer, R"===("discharge": "%sA",)===", String(bms.current < 0 ? -bms.current : 0).c_str());
-    client.println(buffer);
-    sprintf(buffer, R"===("totalVoltage": "%sV",)===", String(bms.totalVoltage).c_str());
-    client.println(buffer);
-    sprintf(buffer, R"===("remainingSOC": %d,)===", bms.stateOfCharge);
-    client.println(buffer);
-    sprintf(buffer, R"===("minVoltage": "%sV",)===", String(bms.minVoltage24).c_str());
-    client.println(buffer);
-    sprintf(buffer, R"===("maxVoltage": "%sV",)===", String(bms.maxVoltage24).c_str());
-    client.println(buffer);
-    sprintf(buffer, R"===("maxCharge": "%sA",)===", String(bms.maxCharge24).c_str());
-    client.println(buffer);
-    sprintf(buffer, R"===("maxDischarge": "%sA",)===", String(bms.maxDischarge24).c_str());
-    client.println(buffer);
-    sprintf(buffer, R"===("maxPower": "%sW",)===", String(bms.balanceCapacity).c_str());
-    client.println(buffer);
-    sprintf(buffer, R"===("temp1": "%sC",)===", String(bms.temperatures[0]).c_str());
-    client.println(buffer);
-    sprintf(buffer, R"===("temp2": "%sC")===", String(bms.temperatures[1]).c_str());
-    client.println(buffer);
-    client.println("}");
-}
-
-void printCellVoltages(EthernetClient &client) {
-    client.println(R"===({ "cellVoltages":[)===");
-    for(int i = 0; i < NUM_CELLS; i++){
-        char buffer[64] = {0};
-        sprintf(buffer, R"===({"cell":"%d", "cellVoltage":%s, "balancing": %s})===", i, String(bms.cellVoltages[i]).c_str(), bms.isBalancing(i) ? "true" : "false");
-        client.print(buffer);
-        if(i != NUM_CELLS - 1) {
-            client.println(",");
-        } else {
-            client.println();
+    for (uint8_t i = 0; i < min(battery.size(), PERSIST_PACKS); i++) {
+        const PackCheckpoint &pack = state.packs[i];
+        memcpy(battery[i].faultCounts, pack.faultCounts, sizeof(pack.faultCounts));
+        // the extremes before the reset count as samples of now, they stay in the window for another 24 h at most
+        if (pack.maxVoltage24 > 0) {
+            battery[i].add24Sample(pack.minVoltage24, pack.maxCharge24);
+            battery[i].add24Sample(pack.maxVoltage24, -pack.maxDischarge24);
         }
     }
-    client.println(R"===(],)===");
+    for (uint8_t i = 0; i < NUM_PORTS; i++) {
+        relays.set(i, state.relays & 1u << i);
+    }
 }
 
-void printBmsFaults(EthernetClient &client) {
-    client.println(R"===("faults": [)===");
-    char buffer[64] = {0};
-    sprintf(buffer,R"===({"fault": "Single Cell Over-Voltage", "count": %d},)===", bms.faultCounts.singleCellOvervoltageProtection);
-    client.println(buffer);
-    sprintf(buffer,R"===({"fault": "Single Cell Under-Voltage", "count": %d},)===", bms.faultCounts.singleCellUndervoltageProtection);
-    client.println(buffer);
-    sprintf(buffer,R"===({"fault": "Whole Pack Over-Voltage", "count": %d},)===", bms.faultCounts.wholePackOvervoltageProtection);
-    client.println(buffer);
-    sprintf(buffer,R"===({"fault": "Whole Pack Under-Voltage", "count": %d},)===", bms.faultCounts.wholePackUndervoltageProtection);
-    client.println(buffer);
-    sprintf(buffer,R"===({"fault": "Charging Over Temperature", "count": %d},)===", bms.faultCounts.chargingOverTemperatureProtection);
-    client.println(buffer);
-    sprintf(buffer,R"===({"fault": "Charging Low Temperature", "count": %d},)===", bms.faultCounts.chargingLowTemperatureProtection);
-    client.println(buffer);
-    sprintf(buffer,R"===({"fault": "Discharge Over Temperature", "count": %d},)===", bms.faultCounts.dischargeOverTemperatureProtection);
-    client.println(buffer);
-    sprintf(buffer,R"===({"fault": "Discharge Low Temperature", "count": %d},)===", bms.faultCounts.dischargeLowTemperatureProtection);
-    client.println(buffer);
-    sprintf(buffer,R"===({"fault": "Charging Over-Current", "count": %d},)===", bms.faultCounts.chargingOvercurrentProtection);
-    client.println(buffer);
-    sprintf(buffer,R"===({"fault": "Discharge Over-Current", "count": %d},)===", bms.faultCounts.dischargeOvercurrentProtection);
-    client.println(buffer);
-    sprintf(buffer,R"===({"fault": "Short Circuit", "count": %d},)===", bms.faultCounts.shortCircuitProtection);
-    client.println(buffer);
-    sprintf(buffer,R"===({"fault": "Front End Detection Ic Error", "count": %d},)===", bms.faultCounts.frontEndDetectionIcError);
-    client.println(buffer);
-    sprintf(buffer,R"===({"fault": "Software Lock Mos", "count": %d})===", bms.faultCounts.softwareLockMos);
-    client.println(buffer);
-    client.println(R"===(],)===");
-}
+void measureAndLogSensors(time_t &now) {
+    TimingScope timing(timings[TIMING_SENSORS]);
+    // fixed-point as returned by the sensor: Pa, 0.01 °C and 0.001 %RH, humidity is kept in 0.01 %RH
+    SensorData record = {now, (int32_t) bme.readFixedPressure(), (int16_t) bme.readFixedTempC(), (uint16_t) (bme.readFixedHumidity() / 10)};
+    sensorData.push(record);
+    hourlySensorData.add(record);
+    dailySensorData.add(record);
 
-// send an NTP request to the time server at the given address
-void sendNtpPacket(const char * address) {
-    // set all bytes in the buffer to 0
-    memset(packetBuffer, 0, ntpPacketSize);
-    // Initialize values needed to form NTP request
-    // (see URL above for details on the packets)
-    packetBuffer[0] = 0b11100011;   // LI, Version, Mode
-    packetBuffer[1] = 0;     // Stratum, or type of clock
-    packetBuffer[2] = 6;     // Polling Interval
-    packetBuffer[3] = 0xEC;  // Peer Clock Precision
-    // 8 bytes of zero for Root Delay & Root Dispersion
-    packetBuffer[12]  = 49;
-    packetBuffer[13]  = 0x4E;
-    packetBuffer[14]  = 49;
-    packetBuffer[15]  = 52;
-
-    // all NTP fields have been given values, now
-    // you can send a packet requesting a timestamp:
-    Udp.beginPacket(address, 123); // NTP requests are to port 123
-    Udp.write(packetBuffer, ntpPacketSize);
-    Udp.endPacket();
+#if DEBUG
+    char buffer[48] = {0};
+    sprintf(buffer, "%lu, %ld, %d, %u", (unsigned long) sensorData.newest().readoutTime, (long) sensorData.newest().pressure,
+            sensorData.newest().temperature, sensorData.newest().humidity);
+    Serial.println(buffer);
+#endif
 }
 
-time_t getNtpTime() {
-    while (Udp.parsePacket() > 0) ; // discard any previously received packets
-    sendNtpPacket(ntpServer);
-    uint32_t beginWait = millis();
-    uint32_t now = beginWait;
-    while (beginWait > now - 2000) {
-        int size = Udp.parsePacket();
-        if (size >= ntpPacketSize) {
-            Udp.read(packetBuffer, ntpPacketSize);  // read packet into the buffer
-            unsigned long secsSince1900;
-            // convert four bytes starting at location 40 to a long integer
-            secsSince1900 =  (unsigned long)packetBuffer[40] << (uint8_t) 24;
-            secsSince1900 |= (unsigned long)packetBuffer[41] << (uint8_t) 16;
-            secsSince1900 |= (unsigned long)packetBuffer[42] << (uint8_t) 8;
-            secsSince1900 |= (unsigned long)packetBuffer[43];
-            return secsSince1900 - NTP_OFFSET + UNIX_OFFSET + timeZone * SECS_PER_HOUR;
-        }
-        now = millis();
+void handleHttpRequest(EthernetClient &client, const Request &request) {
+    TimingScope timing(timings[TIMING_HTTP]);
+    switch (request.type) {
+        case GET:
+            printWebPage(client, request.url, GET, request.ifNoneMatch, requestQuery(request));
+            break;
+        case POST:
+            if (request.powerPort < 0 || request.powerPort >= NUM_PORTS) {
+                break;
+            }
+            switch(request.command){
+                case OFF:
+                    relays.set(request.powerPort, false);
+                    break;
+                case ON:
+                    relays.set(request.powerPort, true);
+                    break;
+                case CYCLE:
+                    relays.cycle(request.powerPort);
+                    break;
+                default:
+                    break;
+            }
+            // a switched port has to come back in the same state after a reset, soon but not on every click
+            if ((int32_t) (scheduler[persistTask].deadline - millis()) > (int32_t) CHECKPOINT_DELAY) {
+                scheduler.defer(persistTask, CHECKPOINT_DELAY);
+            }
+            printWebPage(client, "/", POST);
+            break;
+        default:
+            break;
+
     }
-    return 0; // return 0 if unable to get the time
 }
-
@@ -0,0 +1,148 @@
+//
+// Host microbenchmarks for the hot paths, run with: pio test -e native -f bench
+// Reports wall clock ns/op on the build machine and heap allocations per op, which carry over to the target.
+//
+
+#if defined(NATIVE_HAL) && defined(UNIT_TEST)
+
+#include <unity.h>
+#include <Arduino.h>
+#include <Ethernet.h>
+#include <TimeLib.h>
+#include <bms.h>
+#include <web.h>
+#include <parser.h>
+#include <time.h>
+
+RelayBank relays(3);
+TimingHistogram timings[NUM_TIMINGS];
+SensorHistory<numSensorRecords, numSensorBlocks> sensorData;
+SensorTier<numHourlyRecords, 3600UL> hourlySensorData;
+SensorTier<numDailyRecords, 86400UL> dailySensorData;
+BatteryBank battery;
+AdaptivePoller bmsPoller;
+FaultJournal faultJournal;
+EnergyCounter energy;
+
+static MockSocket socket;
+static char sinceQuery[24]; // asks for the newest record only
+static uint32_t socketWrites; // write() calls summed over a benchmark run, each one is an SPI burst on the target
+
+static uint8_t basicInfoFrame[] = {0xDD, 0x03, 0x00, 0x1B, 0x17, 0x00, 0x00, 0x00, 0x02, 0xD0, 0x03, 0xE8, 0x00, 0x00, 0x20, 0x78, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x48, 0x03, 0x0F, 0x02, 0x0B, 0x76, 0x0B, 0x82, 0xFB, 0xFF};
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+typedef void (*BenchFunction)();
+
+static uint64_t nanoseconds() {
+    struct timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void runBenchmark(const char *name, BenchFunction function, uint32_t iterations) {
+    function(); // warm up
+    resetAllocationCount();
+    socketWrites = 0;
+    uint64_t start = nanoseconds();
+    for (uint32_t i = 0; i < iterations; i++) {
+        function();
+    }
+    uint64_t elapsed = nanoseconds() - start;
+    printf("%-28s %10.1f ns/op %8.1f allocs/op %8.1f writes/op\n", name, (double) elapsed / iterations,
+           (double) allocationCount() / iterations, (double) socketWrites / iterations);
+}
+
+static void benchValidateResponse() {
+    battery[0].validateResponse(basicInfoFrame, CMD_BASIC_SYSTEM_INFO, sizeof(basicInfoFrame));
+}
+
+static void benchParseBasicInfoResponse() {
+    battery[0].parseBasicInfoResponse(basicInfoFrame);
+}
+
+static void benchParseGetRequest() {
+    mockSocketReset(socket, "GET /sensors.json HTTP/1.1\r\nHost: 192.168.1.2\r\nAccept: */*\r\n\r\n");
+    EthernetClient client(&socket);
+    RequestParser parser;
+    parser.begin();
+    parser.update(client);
+}
+
+static void renderPage(const char *url) {
+    mockSocketReset(socket);
+    printWebPage(EthernetClient(&socket), url, GET);
+    socketWrites += socket.writeCalls;
+}
+
+static void benchRenderIndex() {
+    renderPage("/");
+}
+
+static void benchRenderSwitches() {
+    renderPage("/switches.json");
+}
+
+static void benchRenderBattery() {
+    renderPage("/battery.json");
+}
+
+static void benchRenderSensors() {
+    renderPage("/sensors.json");
+}
+
+static void benchRenderSensorsSince() {
+    mockSocketReset(socket);
+    printWebPage(EthernetClient(&socket), "/sensors.json", GET, 0, sinceQuery);
+    socketWrites += socket.writeCalls;
+}
+
+static void benchRenderSensorsHourly() {
+    mockSocketReset(socket);
+    printWebPage(EthernetClient(&socket), "/sensors.json", GET, 0, "step=3600");
+    socketWrites += socket.writeCalls;
+}
+
+static uint32_t sensorsTag;
+
+static void benchRenderSensorsNotModified() {
+    mockSocketReset(socket);
+    printWebPage(EthernetClient(&socket), "/sensors.json", GET, sensorsTag);
+    socketWrites += socket.writeCalls;
+}
+
+static void testBenchmarks() {
+    time_t start = 1600000000;
+    for (int i = 0; i < numSensorRecords; i++) {
+        sensorData.push({(time_t) (start + i * SENSOR_SLOT_SECONDS), 101325 + i % 7, (int16_t) (1250 + i % 50), 4550});
+    }
+    battery[0].parseBasicInfoResponse(basicInfoFrame);
+    setTime(start);
+    mockSocketReset(socket);
+    printWebPage(EthernetClient(&socket), "/sensors.json", GET);
+    sprintf(sinceQuery, "since=%lu", (unsigned long) (sensorData.newest().readoutTime - 1));
+    sensorsTag = strtoul(strstr((const char *) socket.tx, "ETag: \"") + 7, nullptr, 16);
+
+    runBenchmark("validateResponse", benchValidateResponse, 100000);
+    runBenchmark("parseBasicInfoResponse", benchParseBasicInfoResponse, 100000);
+    runBenchmark("RequestParser GET", benchParseGetRequest, 10000);
+    runBenchmark("render /", benchRenderIndex, 1000);
+    runBenchmark("render /switches.json", benchRenderSwitches, 10000);
+    runBenchmark("render /battery.json", benchRenderBattery, 10000);
+    runBenchmark("render /sensors.json", benchRenderSensors, 1000);
+    runBenchmark("render /sensors.json 304", benchRenderSensorsNotModified, 10000);
+    runBenchmark("render /sensors.json since", benchRenderSensorsSince, 10000);
+    runBenchmark("render /sensors.json step=1h", benchRenderSensorsHourly, 1000);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(testBenchmarks);
+    return UNITY_END();
+}
+
+#endif
@@ -14,6 +14,7 @@
 #define TEST_COMMANDS2 false
 #define TEST_VALIDATE_BASIC_INFO false
 #define TEST_VALIDATE_VOLTAGES_NAME false
+#define TEST_FRAME_RECEIVER false
 
 void testSoftwareVersion(){
     SoftwareVersion version;
@@ -43,92 +44,75 @@ void testProductionDateAssignment(){
 
 void testProtectionStatus() {
     ProtectionStatus status;
-    TEST_ASSERT_EQUAL(false, status.singleCellOvervoltageProtection);
-    TEST_ASSERT_EQUAL(false, status.singleCellUndervoltageProtection);
-    TEST_ASSERT_EQUAL(false, status.wholePackOvervoltageProtection);
-    TEST_ASSERT_EQUAL(false, status.wholePackUndervoltageProtection);
-    TEST_ASSERT_EQUAL(false, status.chargingOverTemperatureProtection);
-    TEST_ASSERT_EQUAL(false, status.chargingLowTemperatureProtection);
-    TEST_ASSERT_EQUAL(false, status.dischargeOverTemperatureProtection);
-    TEST_ASSERT_EQUAL(false, status.dischargeLowTemperatureProtection);
-    TEST_ASSERT_EQUAL(false, status.chargingOvercurrentProtection);
-    TEST_ASSERT_EQUAL(false, status.dischargeOvercurrentProtection);
-    TEST_ASSERT_EQUAL(false, status.shortCircuitProtection);
-    TEST_ASSERT_EQUAL(false, status.frontEndDetectionIcError);
-    TEST_ASSERT_EQUAL(false, status.softwareLockMos);
+    TEST_ASSERT_EQUAL(0, status.bits);
+    for (uint8_t i = 0; i < NUM_FAULTS; i++) {
+        TEST_ASSERT_EQUAL(false, status.isSet(i));
+    }
+    TEST_ASSERT_EQUAL(false, status.isAnySet());
 }
 
 void testProtectionStatusAssignment() {
     ProtectionStatus status = 0x1FFF;
-    TEST_ASSERT_EQUAL(true, status.singleCellOvervoltageProtection);
-    TEST_ASSERT_EQUAL(true, status.singleCellUndervoltageProtection);
-    TEST_ASSERT_EQUAL(true, status.wholePackOvervoltageProtection);
-    TEST_ASSERT_EQUAL(true, status.wholePackUndervoltageProtection);
-    TEST_ASSERT_EQUAL(true, status.chargingOverTemperatureProtection);
-    TEST_ASSERT_EQUAL(true, status.chargingLowTemperatureProtection);
-    TEST_ASSERT_EQUAL(true, status.dischargeOverTemperatureProtection);
-    TEST_ASSERT_EQUAL(true, status.dischargeLowTemperatureProtection);
-    TEST_ASSERT_EQUAL(true, status.chargingOvercurrentProtection);
-    TEST_ASSERT_EQUAL(true, status.dischargeOvercurrentProtection);
-    TEST_ASSERT_EQUAL(true, status.shortCircuitProtection);
-    TEST_ASSERT_EQUAL(true, status.frontEndDetectionIcError);
-    TEST_ASSERT_EQUAL(true, status.softwareLockMos);
+    for (uint8_t i = 0; i < NUM_FAULTS; i++) {
+        TEST_ASSERT_EQUAL(true, status.isSet(i));
+    }
+    TEST_ASSERT_EQUAL(true, status.isAnySet());
 }
 
 void testCalculateChecksumCmdBasicSystemInfo(){
-    BMS bms;
+    BMS<8, 2> bms;
     uint8_t *data = bms.basicSystemInfoCommand;
-    TEST_ASSERT_EQUAL(0xFFFD, BMS::calculateChecksum(&data[2], 2));
+    TEST_ASSERT_EQUAL(0xFFFD, BmsCore::calculateChecksum(&data[2], 2));
 }
 
 void testCalculateChecksumCmdCellVoltages(){
-    BMS bms;
+    BMS<8, 2> bms;
     uint8_t *data = bms.cellVoltagesCommand;
-    TEST_ASSERT_EQUAL(0xFFFC, BMS::calculateChecksum(&data[2], 2));
+    TEST_ASSERT_EQUAL(0xFFFC, BmsCore::calculateChecksum(&data[2], 2));
 }
 
 void testCalculateChecksumCmdName(){
-    BMS bms;
+    BMS<8, 2> bms;
     uint8_t *data = bms.nameCommand;
-    TEST_ASSERT_EQUAL(0xFFFB, BMS::calculateChecksum(&data[2], 2));
+    TEST_ASSERT_EQUAL(0xFFFB, BmsCore::calculateChecksum(&data[2], 2));
 }
 
 void testMosfetCommandStringNoChargeNoDischarge(){
-    BMS bms;
+    BMS<8, 2> bms;
     uint8_t data[] = {START_BYTE, WRITE, CMD_CTL_MOSFET, 0x02, 0x00, 0x00, 0x00, 0x00, STOP_BYTE};
     bms.calculateMosfetCommandString(data, false, false);
-    TEST_ASSERT_EQUAL_HEX(0xFF1A, BMS::calculateChecksum(&data[2], 4));
+    TEST_ASSERT_EQUAL_HEX(0xFF1A, BmsCore::calculateChecksum(&data[2], 4));
 }
 
 void testMosfetCommandStringChargeNoDischarge(){
-    BMS bms;
+    BMS<8, 2> bms;
     uint8_t data[]  = {START_BYTE, WRITE, CMD_CTL_MOSFET, 0x02, 0x00, 0x00, 0x00, 0x00, STOP_BYTE};
     bms.calculateMosfetCommandString(data, true, false);
-    TEST_ASSERT_EQUAL_HEX(0xFF1B, BMS::calculateChecksum(&data[2], 4));
+    TEST_ASSERT_EQUAL_HEX(0xFF1B, BmsCore::calculateChecksum(&data[2], 4));
 }
 
 void testMosfetCommandStringNoChargeDischarge(){
-    BMS bms;
+    BMS<8, 2> bms;
     uint8_t data[]  = {START_BYTE, WRITE, CMD_CTL_MOSFET, 0x02, 0x00, 0x00, 0x00, 0x00, STOP_BYTE};
     bms.calculateMosfetCommandString(data, false, true);
-    TEST_ASSERT_EQUAL_HEX(0xFF1C, BMS::calculateChecksum(&data[2], 4));
+    TEST_ASSERT_EQUAL_HEX(0xFF1C, BmsCore::calculateChecksum(&data[2], 4));
 }
 
 void testMosfetCommandStringChargeDischarge(){
-    BMS bms;
+    BMS<8, 2> bms;
     uint8_t data[]  = {START_BYTE, WRITE, CMD_CTL_MOSFET, 0x02, 0x00, 0x00, 0x00, 0x00, STOP_BYTE};
     bms.calculateMosfetCommandString(data, true, true);
-    TEST_ASSERT_EQUAL_HEX(0xFF1D, BMS::calculateChecksum(&data[2], 4));
+    TEST_ASSERT_EQUAL_HEX(0xFF1D, BmsCore::calculateChecksum(&data[2], 4));
 }
 
 void testValidateResponse(){
-    BMS bms;
+    BMS<8, 2> bms;
     uint8_t data[]  = {0xDD, 0x03, 0x00, 0x1B, 0x17, 0x00, 0x00, 0x00, 0x02, 0xD0, 0x03, 0xE8, 0x00, 0x00, 0x20, 0x78, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x48, 0x03, 0x0F, 0x02, 0x0B, 0x76, 0x0B, 0x82, 0xFB, 0xFF};
     TEST_ASSERT_EQUAL(true, bms.validateResponse(data, 0x03, sizeof(data)));
 }
 
 void testBasicInfoResponse(){
-    BMS bms;
+    BMS<8, 2> bms;
     uint8_t data[]  = {0xDD, 0x03, 0x00, 0x1B, 0x17, 0x00, 0x00, 0x00, 0x02, 0xD0, 0x03, 0xE8, 0x00, 0x00, 0x20, 0x78, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x48, 0x03, 0x0F, 0x02, 0x0B, 0x76, 0x0B, 0x82, 0xFB, 0xFF};
     bms.parseBasicInfoResponse(data);
     TEST_ASSERT_EQUAL_FLOAT(58.88, bms.totalVoltage);
@@ -143,32 +127,10 @@ void testBasicInfoResponse(){
         TEST_ASSERT_EQUAL(false, bms.isBalancing(i));
     }
 
-    TEST_ASSERT_EQUAL(0, bms.faultCounts.singleCellOvervoltageProtection);
-    TEST_ASSERT_EQUAL(0, bms.faultCounts.singleCellUndervoltageProtection);
-    TEST_ASSERT_EQUAL(0, bms.faultCounts.wholePackOvervoltageProtection);
-    TEST_ASSERT_EQUAL(0, bms.faultCounts.wholePackUndervoltageProtection);
-    TEST_ASSERT_EQUAL(0, bms.faultCounts.chargingOverTemperatureProtection);
-    TEST_ASSERT_EQUAL(0, bms.faultCounts.chargingLowTemperatureProtection);
-    TEST_ASSERT_EQUAL(0, bms.faultCounts.dischargeOverTemperatureProtection);
-    TEST_ASSERT_EQUAL(0, bms.faultCounts.dischargeLowTemperatureProtection);
-    TEST_ASSERT_EQUAL(0, bms.faultCounts.chargingOvercurrentProtection);
-    TEST_ASSERT_EQUAL(0, bms.faultCounts.dischargeOvercurrentProtection);
-    TEST_ASSERT_EQUAL(0, bms.faultCounts.shortCircuitProtection);
-    TEST_ASSERT_EQUAL(0, bms.faultCounts.frontEndDetectionIcError);
-    TEST_ASSERT_EQUAL(0, bms.faultCounts.softwareLockMos);
-    TEST_ASSERT_EQUAL(false, bms.protectionStatus.singleCellOvervoltageProtection);
-    TEST_ASSERT_EQUAL(false, bms.protectionStatus.singleCellUndervoltageProtection);
-    TEST_ASSERT_EQUAL(false, bms.protectionStatus.wholePackOvervoltageProtection);
-    TEST_ASSERT_EQUAL(false, bms.protectionStatus.wholePackUndervoltageProtection);
-    TEST_ASSERT_EQUAL(false, bms.protectionStatus.chargingOverTemperatureProtection);
-    TEST_ASSERT_EQUAL(false, bms.protectionStatus.chargingLowTemperatureProtection);
-    TEST_ASSERT_EQUAL(false, bms.protectionStatus.dischargeOverTemperatureProtection);
-    TEST_ASSERT_EQUAL(false, bms.protectionStatus.dischargeLowTemperatureProtection);
-    TEST_ASSERT_EQUAL(false, bms.protectionStatus.chargingOvercurrentProtection);
-    TEST_ASSERT_EQUAL(false, bms.protectionStatus.dischargeOvercurrentProtection);
-    TEST_ASSERT_EQUAL(false, bms.protectionStatus.shortCircuitProtection);
-    TEST_ASSERT_EQUAL(false, bms.protectionStatus.frontEndDetectionIcError);
-    TEST_ASSERT_EQUAL(false, bms.protectionStatus.softwareLockMos);
+    for (uint8_t i = 0; i < NUM_FAULTS; i++) {
+        TEST_ASSERT_EQUAL(0, bms.faultCounts[i]);
+    }
+    TEST_ASSERT_EQUAL(0, bms.protectionStatus.bits);
     TEST_ASSERT_EQUAL(1, bms.softwareVersion.major);
     TEST_ASSERT_EQUAL(0, bms.softwareVersion.minor);
     TEST_ASSERT_EQUAL(72, bms.stateOfCharge);
@@ -181,7 +143,7 @@ void testBasicInfoResponse(){
 }
 
 void testVoltagesResponse(){
-    BMS bms;
+    BMS<8, 2> bms;
     bms.numCells = 15;
     uint8_t data[]  = {0xDD, 0x04, 0x00, 0x1E, 0x0F, 0x66, 0x0F, 0x63, 0x0F, 0x63, 0x0F, 0x64, 0x0F, 0x3E, 0x0F, 0x63, 0x0F, 0x37, 0x0F, 0x5B, 0x0F, 0x65, 0x0F, 0x3B, 0x0F, 0x63, 0x0F, 0x63, 0x0F, 0x3C, 0x0F, 0x66, 0x0F, 0x3D, 0xF9, 0xF9};
     bms.parseVoltagesResponse(data);
@@ -196,10 +158,32 @@ void testVoltagesResponse(){
 }
 
 void testNameResponse(){
-    BMS bms;
+    BMS<8, 2> bms;
     uint8_t data[]  = {0xDD, 0x05, 0x00, 0x0A, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0xFD, 0xE9};
     bms.parseNameResponse(data);
-    TEST_ASSERT_EQUAL_STRING("0123456789", bms.name.c_str());
+    TEST_ASSERT_EQUAL_STRING("0123456789", bms.name);
+}
+
+void testFrameReceiverStopBytePayload(){
+    BMS<8, 2> bms;
+    bms.numCells = 2;
+    // second byte of the first cell voltage is 0x77, which used to terminate the frame early
+    uint8_t data[]  = {0xDD, 0x04, 0x00, 0x04, 0x0F, 0x77, 0x0F, 0x66, 0xFF, 0x01, 0x77};
+    for (uint8_t i : data) {
+        bms.receiveByte(i);
+    }
+    TEST_ASSERT_EQUAL(false, bms.hasComError());
+    TEST_ASSERT_EQUAL_FLOAT(3.959, bms.cellVoltages[0]);
+    TEST_ASSERT_EQUAL_FLOAT(3.942, bms.cellVoltages[1]);
+}
+
+void testFrameReceiverResync(){
+    BMS<8, 2> bms;
+    uint8_t data[]  = {0x00, 0x77, 0xDD, 0x05, 0x00, 0x0A, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0xFD, 0xE9, 0x77};
+    for (uint8_t i : data) {
+        bms.receiveByte(i);
+    }
+    TEST_ASSERT_EQUAL_STRING("0123456789", bms.name);
 }
 
 void setup() {
@@ -232,6 +216,10 @@ void setup() {
 #if TEST_VALIDATE_VOLTAGES_NAME
     RUN_TEST(testVoltagesResponse);
     RUN_TEST(testNameResponse);
+#endif
+#if TEST_FRAME_RECEIVER
+    RUN_TEST(testFrameReceiverStopBytePayload);
+    RUN_TEST(testFrameReceiverResync);
 #endif
     UNITY_END();
 }
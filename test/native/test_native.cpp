@@ -0,0 +1,1445 @@
+//
+// Host tests for lib/bms and lib/web, run with: pio test -e native
+//
+
+#if defined(NATIVE_HAL) && defined(UNIT_TEST)
+
+#include <unity.h>
+#include <Arduino.h>
+#include <Ethernet.h>
+#include <bms.h>
+#include <web.h>
+#include <writer.h>
+#include <format.h>
+#include <parser.h>
+#include <connections.h>
+#include <ntp.h>
+#include <scheduler.h>
+#include <persist.h>
+#include <EEPROM.h>
+
+RelayBank relays(3);
+TimingHistogram timings[NUM_TIMINGS];
+SensorHistory<numSensorRecords, numSensorBlocks> sensorData;
+SensorTier<numHourlyRecords, 3600UL> hourlySensorData;
+SensorTier<numDailyRecords, 86400UL> dailySensorData;
+BatteryBank battery;
+AdaptivePoller bmsPoller;
+FaultJournal faultJournal;
+EnergyCounter energy;
+
+static MockSocket socket;
+
+static const uint8_t basicInfoFrame[] = {0xDD, 0x03, 0x00, 0x1B, 0x17, 0x00, 0x00, 0x00, 0x02, 0xD0, 0x03, 0xE8, 0x00, 0x00, 0x20, 0x78, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x48, 0x03, 0x0F, 0x02, 0x0B, 0x76, 0x0B, 0x82, 0xFB, 0xFF, 0x77};
+static const uint8_t voltagesFrame[] = {0xDD, 0x04, 0x00, 0x1E, 0x0F, 0x66, 0x0F, 0x63, 0x0F, 0x63, 0x0F, 0x64, 0x0F, 0x3E, 0x0F, 0x63, 0x0F, 0x37, 0x0F, 0x5B, 0x0F, 0x65, 0x0F, 0x3B, 0x0F, 0x63, 0x0F, 0x63, 0x0F, 0x3C, 0x0F, 0x66, 0x0F, 0x3D, 0xF9, 0xF9, 0x77};
+static const uint8_t nameFrame[] = {0xDD, 0x05, 0x00, 0x0A, 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0xFD, 0xE9, 0x77};
+
+static const char *response() {
+    socket.tx[socket.txLength < sizeof(socket.tx) ? socket.txLength : sizeof(socket.tx) - 1] = 0;
+    return (const char *) socket.tx;
+}
+
+void setUp() {
+    Serial1.clear();
+    Serial2.clear();
+    setMockMicros(0);
+}
+
+void tearDown() {
+}
+
+static Request parse(const char *text) {
+    mockSocketReset(socket, text);
+    EthernetClient client(&socket);
+    RequestParser parser;
+    parser.begin();
+    parser.update(client);
+    return parser.isComplete() ? parser.request() : Request{-1};
+}
+
+void testParseGetRequest() {
+    Request request = parse("GET /battery.json HTTP/1.1\r\nHost: 192.168.1.2\r\n\r\n");
+    TEST_ASSERT_EQUAL(GET, request.type);
+    TEST_ASSERT_EQUAL_STRING("/battery.json", request.url);
+}
+
+void testParsePostRequest() {
+    Request request = parse("POST / HTTP/1.1\r\nHost: 192.168.1.2\r\nContent-Length: 8\r\n\r\npower2=1");
+    TEST_ASSERT_EQUAL(POST, request.type);
+    TEST_ASSERT_EQUAL(2, request.powerPort);
+    TEST_ASSERT_EQUAL(ON, request.command);
+}
+
+void testParsePostWithoutPort() {
+    Request request = parse("POST / HTTP/1.1\r\nHost: 192.168.1.2\r\nContent-Length: 9\r\n\r\nswitch2=1");
+    TEST_ASSERT_EQUAL(POST, request.type);
+    TEST_ASSERT_EQUAL(-1, request.powerPort);
+    TEST_ASSERT_EQUAL(-1, request.command);
+    request = parse("POST / HTTP/1.1\r\nHost: 192.168.1.2\r\nContent-Length: 8\r\n\r\npowerX=1");
+    TEST_ASSERT_EQUAL(-1, request.powerPort);
+}
+
+void testParseUnsupportedRequest() {
+    Request request = parse("DELETE / HTTP/1.1\r\n\r\n");
+    TEST_ASSERT_EQUAL(UNSUPPORTED, request.type);
+}
+
+void testParseLongUrl() {
+    Request request = parse("GET /aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa HTTP/1.1\r\nHost: x\r\n\r\n");
+    TEST_ASSERT_EQUAL(GET, request.type);
+    TEST_ASSERT_EQUAL(URL_LENGTH - 1, strlen(request.url));
+}
+
+// serving a request must not touch the heap, on 6 KB of SRAM fragmentation eventually hangs the controller
+void testRequestPathDoesNotAllocate() {
+    static const char *requests[] = {
+            "GET / HTTP/1.1\r\nHost: 192.168.1.2\r\nAccept: text/html\r\n\r\n",
+            "GET /switches.json HTTP/1.1\r\nHost: 192.168.1.2\r\n\r\n",
+            "GET /battery.json HTTP/1.1\r\nHost: 192.168.1.2\r\n\r\n",
+            "GET /sensors.json HTTP/1.1\r\nHost: 192.168.1.2\r\n\r\n",
+            "POST / HTTP/1.1\r\nHost: 192.168.1.2\r\nContent-Length: 8\r\n\r\npower0=1",
+    };
+    sensorData.push({1600000000, 101325, 2050, 4500});
+    for (const char *text : requests) {
+        mockSocketReset(socket, text);
+        resetAllocationCount();
+        EthernetClient client(&socket);
+        RequestParser parser;
+        parser.begin();
+        parser.update(client);
+        printWebPage(client, parser.request().type == POST ? "/" : parser.request().url, parser.request().type);
+        TEST_ASSERT_EQUAL(0, allocationCount());
+    }
+    sensorData.clear();
+}
+
+void testParseSplitRequest() {
+    static const char text[] = "POST /x HTTP/1.1\r\nContent-length: 17\r\n\r\nfoo=bar&power3=2&";
+    RequestParser parser;
+    parser.begin();
+    for (size_t i = 0; i < sizeof(text) - 2; i++) {
+        parser.consume((const uint8_t *) text + i, 1);
+        TEST_ASSERT_EQUAL(false, parser.isComplete());
+    }
+    parser.consume((const uint8_t *) text + sizeof(text) - 2, 1);
+    TEST_ASSERT_EQUAL(true, parser.isComplete());
+    TEST_ASSERT_EQUAL(POST, parser.request().type);
+    TEST_ASSERT_EQUAL_STRING("/x", parser.request().url);
+    TEST_ASSERT_EQUAL(3, parser.request().powerPort);
+    TEST_ASSERT_EQUAL(CYCLE, parser.request().command);
+}
+
+// a client that stalls mid-request must not hold the loop beyond REQUEST_TIMEOUT
+void testParseTimeout() {
+    mockSocketReset(socket, "GET /battery.json HTTP/1.1\r\nHost: 192.");
+    EthernetClient client(&socket);
+    RequestParser parser;
+    parser.begin();
+    TEST_ASSERT_EQUAL(false, parser.update(client));
+    advanceMockMillis(REQUEST_TIMEOUT);
+    TEST_ASSERT_EQUAL(false, parser.update(client));
+    advanceMockMillis(1);
+    TEST_ASSERT_EQUAL(true, parser.update(client));
+    TEST_ASSERT_EQUAL(true, parser.isFailed());
+    TEST_ASSERT_EQUAL(true, parser.hasTimedOut());
+}
+
+void testParseReadBudget() {
+    static char text[1024];
+    strcpy(text, "GET / HTTP/1.1\r\n");
+    while (strlen(text) < sizeof(text) - 32) {
+        strcat(text, "X-Filler: aaaaaaaaaaaaaaaa\r\n");
+    }
+    strcat(text, "\r\n");
+    mockSocketReset(socket, text);
+    EthernetClient client(&socket);
+    RequestParser parser;
+    parser.begin();
+    uint8_t calls = 1;
+    while (!parser.update(client)) {
+        TEST_ASSERT_EQUAL(calls * PARSER_READ_BUDGET, socket.rxPosition);
+        calls++;
+    }
+    TEST_ASSERT_EQUAL(true, parser.isComplete());
+    TEST_ASSERT_EQUAL((strlen(text) + PARSER_READ_BUDGET - 1) / PARSER_READ_BUDGET, calls);
+}
+
+static uint8_t handledRequests;
+
+static void countingHandler(EthernetClient &client, const Request &request) {
+    handledRequests++;
+    printWebPage(client, request.url, request.type);
+}
+
+// a slow client must not hold back the requests of a page load that arrive after it
+void testConnectionsAreInterleaved() {
+    static MockSocket slow, fast;
+    mockSocketReset(slow, "GET /sensors.json HTTP/1.1\r\nHo");
+    mockSocketReset(fast, "GET /switches.json HTTP/1.1\r\n\r\n");
+    EthernetServer server(80);
+    ConnectionTable table(countingHandler);
+    handledRequests = 0;
+    server.mockConnect(&slow);
+    server.mockConnect(&fast);
+    table.update(server);
+    TEST_ASSERT_EQUAL(1, handledRequests);
+    TEST_ASSERT_EQUAL(false, fast.connected);
+    TEST_ASSERT_EQUAL(true, slow.connected);
+    TEST_ASSERT_EQUAL(1, table.openConnections());
+
+    strcpy((char *) slow.rx + slow.rxLength, "st: x\r\n\r\n");
+    slow.rxLength += strlen("st: x\r\n\r\n");
+    table.update(server);
+    TEST_ASSERT_EQUAL(2, handledRequests);
+    TEST_ASSERT_EQUAL(0, table.openConnections());
+}
+
+void testConnectionTableFull() {
+    static MockSocket sockets[HTTP_MAX_CONNECTIONS + 1];
+    EthernetServer server(80);
+    ConnectionTable table(countingHandler);
+    for (MockSocket &mockSocket : sockets) {
+        mockSocketReset(mockSocket, "GET / HTTP/1.1\r\n");
+        server.mockConnect(&mockSocket);
+    }
+    table.update(server);
+    TEST_ASSERT_EQUAL(HTTP_MAX_CONNECTIONS, table.openConnections());
+    TEST_ASSERT_EQUAL(false, sockets[HTTP_MAX_CONNECTIONS].connected);
+}
+
+static uint32_t responseTag() {
+    const char *header = strstr(response(), "ETag: \"");
+    return header != nullptr ? strtoul(header + 7, nullptr, 16) : 0;
+}
+
+void testParseIfNoneMatch() {
+    Request request = parse("GET /sensors.json HTTP/1.1\r\nif-none-match: W/\"0a1B2c3D\", \"ffffffff\"\r\n\r\n");
+    TEST_ASSERT_EQUAL(0x0a1b2c3dUL, request.ifNoneMatch);
+    request = parse("GET /sensors.json HTTP/1.1\r\nHost: x\r\n\r\n");
+    TEST_ASSERT_EQUAL(0, request.ifNoneMatch);
+}
+
+// an unchanged resource costs the headers only, any new record invalidates the client's copy
+void testConditionalGet() {
+    setTime(1600000000);
+    sensorData.clear();
+    sensorData.push({1600000000, 101325, 2050, 4500});
+    mockSocketReset(socket);
+    printWebPage(EthernetClient(&socket), "/sensors.json", GET);
+    uint32_t tag = responseTag();
+    TEST_ASSERT_NOT_EQUAL(0, tag);
+    TEST_ASSERT_NOT_NULL(strstr(response(), "HTTP/1.1 200 OK"));
+
+    mockSocketReset(socket);
+    printWebPage(EthernetClient(&socket), "/sensors.json", GET, tag);
+    TEST_ASSERT_NOT_NULL(strstr(response(), "HTTP/1.1 304 Not Modified"));
+    TEST_ASSERT_EQUAL(tag, responseTag());
+    TEST_ASSERT_EQUAL(0, strcmp(response() + socket.txLength - 4, "\r\n\r\n"));
+    TEST_ASSERT_EQUAL(true, socket.txLength < 100);
+
+    mockSocketReset(socket);
+    printWebPage(EthernetClient(&socket), "/battery.json", GET, tag);
+    TEST_ASSERT_NOT_NULL(strstr(response(), "HTTP/1.1 200 OK"));
+
+    sensorData.push({1600000900, 101325, 2050, 4500});
+    mockSocketReset(socket);
+    printWebPage(EthernetClient(&socket), "/sensors.json", GET, tag);
+    TEST_ASSERT_NOT_NULL(strstr(response(), "HTTP/1.1 200 OK"));
+    TEST_ASSERT_NOT_EQUAL(tag, responseTag());
+    sensorData.clear();
+}
+
+void testTimingHistogram() {
+    TEST_ASSERT_EQUAL(0, timingBucket(0));
+    TEST_ASSERT_EQUAL(0, timingBucket(1));
+    TEST_ASSERT_EQUAL(1, timingBucket(2));
+    TEST_ASSERT_EQUAL(9, timingBucket(1023));
+    TEST_ASSERT_EQUAL(10, timingBucket(1024));
+    TEST_ASSERT_EQUAL(TIMING_BUCKETS - 1, timingBucket(9000000));
+    TEST_ASSERT_EQUAL(TIMING_BUCKETS - 1, timingBucket(UINT32_MAX));
+
+    TimingHistogram histogram{};
+    recordTiming(histogram, 5);
+    recordTiming(histogram, 700);
+    recordTiming(histogram, 6);
+    TEST_ASSERT_EQUAL(3, histogram.count);
+    TEST_ASSERT_EQUAL(700, histogram.max);
+    TEST_ASSERT_EQUAL(2, histogram.buckets[2]);
+    TEST_ASSERT_EQUAL(1, histogram.buckets[9]);
+
+    // a full bucket halves them all instead of saturating
+    histogram.buckets[2] = UINT16_MAX;
+    histogram.buckets[9] = 101;
+    recordTiming(histogram, 5);
+    TEST_ASSERT_EQUAL(32768, histogram.buckets[2]);
+    TEST_ASSERT_EQUAL(50, histogram.buckets[9]);
+    TEST_ASSERT_EQUAL(4, histogram.count);
+}
+
+void testTimingJson() {
+    memset(timings, 0, sizeof(timings));
+    recordTiming(timings[TIMING_HTTP], 3000);
+    mockSocketReset(socket);
+    resetAllocationCount();
+    printWebPage(EthernetClient(&socket), "/debug/timing.json", GET);
+    TEST_ASSERT_EQUAL(0, allocationCount());
+    TEST_ASSERT_NOT_NULL(strstr(response(), "Content-Type: application/json"));
+    TEST_ASSERT_NOT_NULL(strstr(response(), R"===({"name": "handleHttpRequest", "count": 1, "maxUs": 3000, "histogram": [0,0,0,0,0,0,0,0,0,0,0,1,0,)==="));
+    TEST_ASSERT_NOT_NULL(strstr(response(), R"===({"name": "ntp.update", "count": 0, "maxUs": 0, "histogram": [0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0]})==="));
+}
+
+void testFormatNumbers() {
+    char buffer[FORMAT_BUFFER_SIZE];
+    TEST_ASSERT_EQUAL_STRING("-1.05", formatFixed(buffer, -105));
+    TEST_ASSERT_EQUAL_STRING("0.05", formatFixed(buffer, 5));
+    TEST_ASSERT_EQUAL_STRING("1013.25", formatFixed(buffer, 101325));
+    TEST_ASSERT_EQUAL_STRING("42", formatFixed(buffer, 42, 0));
+    TEST_ASSERT_EQUAL_STRING("58.88", formatFloat(buffer, 58.88f));
+    TEST_ASSERT_EQUAL_STRING("-0.50", formatFloat(buffer, -0.499f));
+    TEST_ASSERT_EQUAL_STRING("3.942", formatFloat(buffer, 3.942f, 3));
+    TEST_ASSERT_EQUAL_STRING("0.00", formatFloat(buffer, 0.0f));
+}
+
+void testSwitchesJson() {
+    relays.set(1, true);
+    mockSocketReset(socket);
+    printWebPage(EthernetClient(&socket), "/switches.json", GET);
+    TEST_ASSERT_NOT_NULL(strstr(response(), "HTTP/1.1 200 OK"));
+    TEST_ASSERT_NOT_NULL(strstr(response(), "Content-Type: application/json"));
+    TEST_ASSERT_NOT_NULL(strstr(response(), R"===({"name": "Imaging Computer 2", "state": true})==="));
+    TEST_ASSERT_NOT_NULL(strstr(response(), R"===({"name": "Port 3", "state": false})==="));
+    relays.set(1, false);
+}
+
+// the response to a cycle request must go out while the port is still off
+void testRelayCycleDoesNotBlock() {
+    relays.set(2, true);
+    relays.cycle(2);
+    TEST_ASSERT_EQUAL(0, millis());
+    TEST_ASSERT_EQUAL(HIGH, digitalRead(5));
+    mockSocketReset(socket);
+    printWebPage(EthernetClient(&socket), "/switches.json", GET);
+    TEST_ASSERT_NOT_NULL(strstr(response(), R"===({"name": "Port 3", "state": "cycling"})==="));
+
+    advanceMockMillis(RELAY_CYCLE_DURATION - 1);
+    relays.update();
+    TEST_ASSERT_EQUAL(true, relays.isCycling(2));
+    advanceMockMillis(1);
+    relays.update();
+    TEST_ASSERT_EQUAL(false, relays.isCycling(2));
+    TEST_ASSERT_EQUAL(true, relays.isOn(2));
+    TEST_ASSERT_EQUAL(LOW, digitalRead(5));
+}
+
+void testRelaySetCancelsCycle() {
+    relays.setCycleDuration(0, 5000);
+    relays.cycle(0);
+    advanceMockMillis(1000);
+    relays.update();
+    TEST_ASSERT_EQUAL(true, relays.isCycling(0));
+    relays.set(0, false);
+    advanceMockMillis(5000);
+    relays.update();
+    TEST_ASSERT_EQUAL(false, relays.isOn(0));
+    relays.setCycleDuration(0, RELAY_CYCLE_DURATION);
+}
+
+void testResponseIsCoalesced() {
+    sensorData.clear();
+    for (int i = 0; i < numSensorRecords; i++) {
+        sensorData.push({(time_t) (1600000000 + i * SENSOR_SLOT_SECONDS), 101325, 2050, 4500});
+    }
+    mockSocketReset(socket);
+    uint16_t segments = printWebPage(EthernetClient(&socket), "/sensors.json", GET);
+    TEST_ASSERT_EQUAL(socket.writeCalls, segments);
+    TEST_ASSERT_EQUAL((socket.txLength + WRITER_SEGMENT_SIZE - 1) / WRITER_SEGMENT_SIZE, segments);
+    TEST_ASSERT_EQUAL(0, strncmp((const char *) socket.tx + socket.txLength - 4, "]}\r\n", 4));
+    sensorData.clear();
+}
+
+void testPostRedirect() {
+    mockSocketReset(socket);
+    printWebPage(EthernetClient(&socket), "/", POST);
+    TEST_ASSERT_NOT_NULL(strstr(response(), "HTTP/1.1 303 See Other"));
+    TEST_ASSERT_NOT_NULL(strstr(response(), "Location: http://192.168.1.2/"));
+}
+
+void testRingBufferOrder() {
+    RingBuffer<int, 4> buffer;
+    TEST_ASSERT_EQUAL(true, buffer.isEmpty());
+    TEST_ASSERT_EQUAL(true, buffer.begin() == buffer.end());
+    for (int i = 1; i <= 6; i++) {
+        buffer.push(i);
+    }
+    TEST_ASSERT_EQUAL(4, buffer.size());
+    int expected = 3;
+    for (int value : buffer) {
+        TEST_ASSERT_EQUAL(expected++, value);
+    }
+    TEST_ASSERT_EQUAL(7, expected);
+    TEST_ASSERT_EQUAL(6, buffer.newest());
+}
+
+void testRingBufferPartial() {
+    RingBuffer<int, 4> buffer;
+    buffer.push(7);
+    buffer.push(8);
+    int count = 0;
+    for (int value : buffer) {
+        TEST_ASSERT_EQUAL(7 + count++, value);
+    }
+    TEST_ASSERT_EQUAL(2, count);
+}
+
+void testSensorsJsonSkipsEmptySlots() {
+    sensorData.clear();
+    sensorData.push({1600000000, 101325, 2050, 4500});
+    sensorData.push({1600000900, 101320, -105, 4498});
+    mockSocketReset(socket);
+    printWebPage(EthernetClient(&socket), "/sensors.json", GET);
+    TEST_ASSERT_NOT_NULL(strstr(response(), R"===({"time":"09-13 12:26", "pressure":1013.25, "temp":20.50, "humidity":45.00})==="));
+    TEST_ASSERT_NOT_NULL(strstr(response(), R"===({"time":"09-13 12:41", "pressure":1013.20, "temp":-1.05, "humidity":44.98})==="));
+    TEST_ASSERT_NULL(strstr(response(), "01-01 00:00"));
+    sensorData.clear();
+}
+
+void testParseQuery() {
+    Request request = parse("GET /sensors.json?since=1600000900&step=3600 HTTP/1.1\r\n\r\n");
+    TEST_ASSERT_EQUAL_STRING("/sensors.json", request.url);
+    TEST_ASSERT_EQUAL_STRING("since=1600000900&step=3600", requestQuery(request));
+    uint32_t value = 0;
+    TEST_ASSERT_EQUAL(true, queryValue(requestQuery(request), "since", value));
+    TEST_ASSERT_EQUAL(1600000900UL, value);
+    TEST_ASSERT_EQUAL(true, queryValue(requestQuery(request), "step", value));
+    TEST_ASSERT_EQUAL(3600, value);
+    TEST_ASSERT_EQUAL(false, queryValue(requestQuery(request), "to", value));
+    TEST_ASSERT_EQUAL(false, queryValue("steps=5&x=", "step", value));
+    TEST_ASSERT_EQUAL_STRING("", requestQuery(parse("GET /sensors.json HTTP/1.1\r\n\r\n")));
+}
+
+static void pushSensorRecords() {
+    sensorData.clear();
+    const int16_t temperatures[] = {2000, 2100, 2300, 1900};
+    for (uint8_t i = 0; i < 4; i++) {
+        sensorData.push({(time_t) (1600000000 + i * SENSOR_SLOT_SECONDS), 101325, temperatures[i], 4500});
+    }
+}
+
+// a chart that is already loaded fetches only what is new
+void testSensorsJsonSince() {
+    pushSensorRecords();
+    mockSocketReset(socket);
+    printWebPage(EthernetClient(&socket), "/sensors.json", GET, 0, "since=1600000900");
+    TEST_ASSERT_NOT_NULL(strstr(response(), R"===({ "newest": 1600002700, "values":[)==="));
+    TEST_ASSERT_NULL(strstr(response(), "12:41"));
+    TEST_ASSERT_NOT_NULL(strstr(response(), R"===({"time":"09-13 12:56", "pressure":1013.25, "temp":23.00, "humidity":45.00},)==="));
+    TEST_ASSERT_NOT_NULL(strstr(response(), R"===({"time":"09-13 13:11", "pressure":1013.25, "temp":19.00, "humidity":45.00})==="));
+
+    mockSocketReset(socket);
+    printWebPage(EthernetClient(&socket), "/sensors.json", GET, 0, "from=1600000900&to=1600001800");
+    TEST_ASSERT_NULL(strstr(response(), "12:26"));
+    TEST_ASSERT_NOT_NULL(strstr(response(), "12:41"));
+    TEST_ASSERT_NOT_NULL(strstr(response(), "12:56"));
+    TEST_ASSERT_NULL(strstr(response(), "13:11"));
+
+    mockSocketReset(socket);
+    printWebPage(EthernetClient(&socket), "/sensors.json", GET, 0, "since=1600002700");
+    TEST_ASSERT_NOT_NULL(strstr(response(), "\"values\":[\r\n\r\n]}"));
+    sensorData.clear();
+}
+
+void testSensorsJsonDownsampled() {
+    pushSensorRecords();
+    mockSocketReset(socket);
+    resetAllocationCount();
+    printWebPage(EthernetClient(&socket), "/sensors.json", GET, 0, "step=3600");
+    TEST_ASSERT_EQUAL(0, allocationCount());
+    TEST_ASSERT_NOT_NULL(strstr(response(), R"===({"time":"09-13 12:00", "pressure":1013.25, "pressureMin":1013.25, "pressureMax":1013.25, "temp":21.33, "tempMin":20.00, "tempMax":23.00, "humidity":45.00, "humidityMin":45.00, "humidityMax":45.00},)==="));
+    TEST_ASSERT_NOT_NULL(strstr(response(), R"===({"time":"09-13 13:00", "pressure":1013.25, "pressureMin":1013.25, "pressureMax":1013.25, "temp":19.00, "tempMin":19.00, "tempMax":19.00, "humidity":45.00, "humidityMin":45.00, "humidityMax":45.00})==="));
+    sensorData.clear();
+}
+
+void testSensorHistoryAfter() {
+    SensorHistory<8, 4> history;
+    history.push({1000, 101325, 2050, 4500});
+    history.push({1900, 101325, 2050, 4500});
+    history.push({5000, 101325, 2050, 4500});
+    history.push({5900, 101320, 2040, 4500});
+    TEST_ASSERT_EQUAL(1000, history.after(999)->readoutTime);
+    TEST_ASSERT_EQUAL(1900, history.after(1000)->readoutTime);
+    TEST_ASSERT_EQUAL(5000, history.after(1900)->readoutTime);
+    TEST_ASSERT_EQUAL(5900, history.after(5000)->readoutTime);
+    TEST_ASSERT_EQUAL(101320, history.after(5000)->pressure);
+    TEST_ASSERT_EQUAL(true, history.after(5900) == history.end());
+    uint8_t count = 0;
+    for (auto record = history.after(1500); record != history.end(); ++record) {
+        count++;
+    }
+    TEST_ASSERT_EQUAL(3, count);
+}
+
+static void assertSensorData(const SensorData &expected, const SensorData &actual) {
+    TEST_ASSERT_EQUAL(expected.readoutTime, actual.readoutTime);
+    TEST_ASSERT_EQUAL(expected.pressure, actual.pressure);
+    TEST_ASSERT_EQUAL(expected.temperature, actual.temperature);
+    TEST_ASSERT_EQUAL(expected.humidity, actual.humidity);
+}
+
+void testSensorHistoryRoundTrip() {
+    SensorHistory<8, 4> history;
+    const SensorData records[] = {
+            {1600000000, 101325, 2050, 4500},
+            {1600000900, 101836, 1027, 5523},  // largest deltas that still fit
+            {1600001800, 101325, 2050, 4500},  // smallest deltas that still fit
+            {1600002700, 101837, 2050, 4500},  // pressure delta too large, absolute record
+            {1600003600, 101837, -2000, 9999}, // temperature and humidity too, absolute record
+            {1600007200, 101837, 2050, 4500},  // gap, new block
+    };
+    for (const SensorData &record : records) {
+        history.push(record);
+    }
+    TEST_ASSERT_EQUAL(6, history.size());
+    int i = 0;
+    for (const SensorData &record : history) {
+        assertSensorData(records[i++], record);
+    }
+    TEST_ASSERT_EQUAL(6, i);
+    TEST_ASSERT_EQUAL(101837, history.after(1600002700)->pressure);
+    TEST_ASSERT_EQUAL(-2000, history.after(1600002700)->temperature);
+}
+
+void testSensorHistoryEviction() {
+    SensorHistory<4, 2> history;
+    for (int i = 0; i < 6; i++) {
+        history.push({(time_t) (1600000000 + i * SENSOR_SLOT_SECONDS), 100000 + i, (int16_t) (-i), (uint16_t) (5000 + i)});
+    }
+    TEST_ASSERT_EQUAL(4, history.size());
+    int i = 2;
+    for (const SensorData &record : history) {
+        assertSensorData({(time_t) (1600000000 + i * SENSOR_SLOT_SECONDS), 100000 + i, (int16_t) (-i), (uint16_t) (5000 + i)}, record);
+        i++;
+    }
+    TEST_ASSERT_EQUAL(6, i);
+}
+
+// jumps are absolute records in the block, evicting them never takes more than the record it makes room for
+void testSensorHistoryJumps() {
+    SensorHistory<8, 2> history;
+    uint16_t previous = 0;
+    for (int i = 0; i < 40; i++) {
+        int16_t temperature = (int16_t) (i / 2 % 2 == 0 ? 2000 : -1000); // a jump every other record
+        history.push({(time_t) (1600000000 + i * SENSOR_SLOT_SECONDS), 100000 + i, (int16_t) (temperature + i), (uint16_t) (5000 + i)});
+        TEST_ASSERT_TRUE(history.size() + 1 >= previous);
+        previous = history.size();
+        int j = i - history.size() + 1;
+        for (const SensorData &record : history) {
+            int16_t expected = (int16_t) (j / 2 % 2 == 0 ? 2000 : -1000);
+            assertSensorData({(time_t) (1600000000 + j * SENSOR_SLOT_SECONDS), 100000 + j, (int16_t) (expected + j), (uint16_t) (5000 + j)}, record);
+            j++;
+        }
+        TEST_ASSERT_EQUAL(i + 1, j);
+    }
+    TEST_ASSERT_TRUE(history.size() >= 5);
+}
+
+void testSensorHistoryBlockEviction() {
+    SensorHistory<8, 2> history;
+    // every push is a gap, so each record needs its own block
+    for (int i = 0; i < 3; i++) {
+        history.push({(time_t) (1600000000 + i * 2 * SENSOR_SLOT_SECONDS), 100000, 0, (uint16_t) i});
+    }
+    TEST_ASSERT_EQUAL(2, history.size());
+    TEST_ASSERT_EQUAL(1, (*history.begin()).humidity);
+}
+
+void testBmsPollCycle() {
+    PackBMS pack;
+    pack.begin(&Serial1);
+    pack.poll();
+    TEST_ASSERT_EQUAL(true, pack.isBusy());
+    // all three queries go out back to back, the name only because it is not known yet
+    TEST_ASSERT_EQUAL(21, Serial1.txLength());
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(pack.basicSystemInfoCommand, Serial1.txData(), sizeof(pack.basicSystemInfoCommand));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(pack.cellVoltagesCommand, Serial1.txData() + 7, sizeof(pack.cellVoltagesCommand));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(pack.nameCommand, Serial1.txData() + 14, sizeof(pack.nameCommand));
+
+    Serial1.inject(basicInfoFrame, sizeof(basicInfoFrame));
+    TEST_ASSERT_EQUAL(false, pack.update());
+    TEST_ASSERT_EQUAL_FLOAT(58.88, pack.totalVoltage);
+
+    Serial1.inject(voltagesFrame, sizeof(voltagesFrame));
+    TEST_ASSERT_EQUAL(false, pack.update());
+    TEST_ASSERT_EQUAL_FLOAT(3.942, pack.cellVoltages[0]);
+    TEST_ASSERT_EQUAL(true, pack.isBusy());
+
+    // the cycle ends with the name, so its reply cannot run into the next pack's on a shared port
+    Serial1.inject(nameFrame, sizeof(nameFrame));
+    TEST_ASSERT_EQUAL(true, pack.update());
+    TEST_ASSERT_EQUAL_STRING("0123456789", pack.name);
+    TEST_ASSERT_EQUAL(false, pack.hasComError());
+    TEST_ASSERT_EQUAL(false, pack.isBusy());
+}
+
+// a frame whose length byte leaves out fields of the layout changes nothing
+void testBasicInfoTooShort() {
+    PackBMS pack;
+    uint8_t frame[sizeof(basicInfoFrame)];
+    memcpy(frame, basicInfoFrame, sizeof(frame));
+    frame[3] = 0x16; // cuts the number of temperature sensors off
+    TEST_ASSERT_FALSE(pack.parseBasicInfoResponse(frame));
+    TEST_ASSERT_EQUAL_FLOAT(0, pack.totalVoltage);
+
+    frame[3] = 0x17; // no room for the temperatures
+    TEST_ASSERT_TRUE(pack.parseBasicInfoResponse(frame));
+    TEST_ASSERT_EQUAL_FLOAT(58.88, pack.totalVoltage);
+    TEST_ASSERT_EQUAL(2, pack.numTemperatureSensors);
+    TEST_ASSERT_EQUAL_FLOAT(0, pack.temperatures[0]);
+}
+
+// a firmware with another field in front of the temperatures
+static const BasicInfoLayout shiftedLayout PROGMEM = {{
+        {4, 2 | FIELD_DECIMALS(2)}, {6, 2 | FIELD_SIGNED | FIELD_DECIMALS(2)}, {8, 2 | FIELD_DECIMALS(2)},
+        {10, 2 | FIELD_DECIMALS(2)}, {12, 2}, {14, 2}, {16, 2}, {18, 2}, {20, 2}, {22, 1}, {23, 1}, {24, 1}, {25, 1},
+        {26, 1}
+}, {29, 2 | FIELD_DECIMALS(1)}};
+
+void testBasicInfoLayout() {
+    PackBMS pack;
+    pack.setBasicInfoLayout(&shiftedLayout);
+    TEST_ASSERT_TRUE(pack.parseBasicInfoResponse(basicInfoFrame));
+    TEST_ASSERT_EQUAL_FLOAT(21.45, pack.temperatures[0]);
+    // the second sensor would be past the data
+    TEST_ASSERT_EQUAL_FLOAT(0, pack.temperatures[1]);
+    TEST_ASSERT_EQUAL(15, pack.numCells);
+    TEST_ASSERT_EQUAL(72, pack.stateOfCharge);
+}
+
+// frame with command and data, returns its length
+static uint8_t buildFrame(uint8_t *frame, uint8_t command, const uint8_t *data, uint8_t length) {
+    frame[0] = START_BYTE;
+    frame[1] = command;
+    frame[2] = 0x00;
+    frame[3] = length;
+    memcpy(&frame[FRAME_DATA], data, length);
+    uint16_t checksum = BmsCore::calculateChecksum(&frame[2], length + 2);
+    frame[FRAME_DATA + length] = checksum >> 8u;
+    frame[FRAME_DATA + length + 1] = checksum & 0xFFu;
+    frame[FRAME_DATA + length + 2] = STOP_BYTE;
+    return length + FRAME_OVERHEAD;
+}
+
+// frames longer than the buffer are cut to it instead of dropped
+void testBmsOversizeFrames() {
+    PackBMS pack;
+    pack.begin(&Serial1);
+    pack.poll();
+    uint8_t frame[80];
+    uint8_t data[40];
+    // two more sensors and a few bytes of fields this layout does not know
+    memcpy(data, &basicInfoFrame[FRAME_DATA], 0x1B);
+    data[22] = 4;
+    memset(&data[0x1B], 0x0B, 12);
+    uint8_t length = buildFrame(frame, CMD_BASIC_SYSTEM_INFO, data, 0x1B + 12);
+    TEST_ASSERT_TRUE(length > bmsFrameLength(numPackCells, numPackTempSensors));
+    Serial1.inject(frame, length);
+    Serial1.inject(voltagesFrame, sizeof(voltagesFrame));
+    memset(data, 'a', 40);
+    Serial1.inject(frame, buildFrame(frame, CMD_NAME, data, 40));
+    TEST_ASSERT_EQUAL(true, pack.update());
+    TEST_ASSERT_EQUAL(false, pack.hasComError());
+    TEST_ASSERT_EQUAL_FLOAT(58.88, pack.totalVoltage);
+    TEST_ASSERT_EQUAL(4, pack.numTemperatureSensors);
+    TEST_ASSERT_EQUAL_FLOAT(20.25, pack.temperatures[0]);
+    TEST_ASSERT_EQUAL_FLOAT(21.45, pack.temperatures[1]);
+    // the name is cut to NAME_LENGTH
+    TEST_ASSERT_EQUAL(NAME_LENGTH, strlen(pack.name));
+
+    // a corrupted byte past the buffer still fails the checksum
+    pack.poll();
+    length = buildFrame(frame, CMD_BASIC_SYSTEM_INFO, data, 40);
+    frame[FRAME_DATA + 38] ^= 0x01;
+    Serial1.inject(frame, length);
+    TEST_ASSERT_EQUAL(false, pack.update());
+    TEST_ASSERT_EQUAL(true, pack.hasComError());
+
+    // a frame just over the buffer, the checksum bytes that made it in are not taken for data
+    BMS<16, 2> small;
+    small.begin(&Serial1);
+    strcpy(small.name, "known");
+    small.poll();
+    for (uint8_t i = 0; i < 17; i++) {
+        data[2 * i] = 0x0F;
+        data[2 * i + 1] = i;
+    }
+    length = buildFrame(frame, CMD_CELL_VOLTAGES, data, 34);
+    TEST_ASSERT_EQUAL(bmsFrameLength(16, 2) + 2, length);
+    Serial1.inject(basicInfoFrame, sizeof(basicInfoFrame));
+    Serial1.inject(frame, length);
+    TEST_ASSERT_EQUAL(true, small.update());
+    TEST_ASSERT_EQUAL(false, small.hasComError());
+    TEST_ASSERT_EQUAL_FLOAT(3.855, small.cellVoltages[15]);
+}
+
+// a smaller pack keeps only its own cells and sensors of the same frames
+void testBmsPackSize() {
+    BMS<4, 1> pack;
+    TEST_ASSERT_EQUAL(4, pack.cellCount());
+    TEST_ASSERT_EQUAL(4 * sizeof(float), sizeof(pack.cellVoltages));
+    TEST_ASSERT_EQUAL(sizeof(float), sizeof(pack.temperatures));
+    TEST_ASSERT_EQUAL(39, bmsFrameLength(8, 2));
+    TEST_ASSERT_EQUAL(55, bmsFrameLength(24, 2));
+
+    pack.begin(&Serial1);
+    strcpy(pack.name, "known");
+    pack.poll();
+    Serial1.inject(basicInfoFrame, sizeof(basicInfoFrame));
+    Serial1.inject(voltagesFrame, sizeof(voltagesFrame));
+    TEST_ASSERT_EQUAL(true, pack.update());
+    TEST_ASSERT_EQUAL(15, pack.numCells);
+    TEST_ASSERT_EQUAL_FLOAT(20.25, pack.temperatures[0]);
+    TEST_ASSERT_EQUAL_FLOAT(3.940, pack.cellVoltages[3]);
+}
+
+// responses are matched by command byte, whatever order they arrive in
+void testBmsPipelinedResponsesOutOfOrder() {
+    PackBMS pack;
+    pack.begin(&Serial1);
+    strcpy(pack.name, "known");
+    pack.poll();
+    TEST_ASSERT_EQUAL(14, Serial1.txLength());
+    Serial1.inject(voltagesFrame, sizeof(voltagesFrame));
+    Serial1.inject(basicInfoFrame, sizeof(basicInfoFrame));
+    TEST_ASSERT_EQUAL(true, pack.update());
+    TEST_ASSERT_EQUAL_FLOAT(58.88, pack.totalVoltage);
+    TEST_ASSERT_EQUAL_FLOAT(3.942, pack.cellVoltages[0]);
+    TEST_ASSERT_EQUAL(1, pack.generation());
+}
+
+void testBmsSequentialPoll() {
+    PackBMS pack;
+    pack.begin(&Serial1);
+    pack.setPipelined(false);
+    pack.poll();
+    TEST_ASSERT_EQUAL(7, Serial1.txLength());
+    Serial1.inject(basicInfoFrame, sizeof(basicInfoFrame));
+    TEST_ASSERT_EQUAL(false, pack.update());
+    TEST_ASSERT_EQUAL(14, Serial1.txLength());
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(pack.cellVoltagesCommand, Serial1.txData() + 7, sizeof(pack.cellVoltagesCommand));
+    Serial1.inject(voltagesFrame, sizeof(voltagesFrame));
+    TEST_ASSERT_EQUAL(false, pack.update());
+    TEST_ASSERT_EQUAL(21, Serial1.txLength());
+    Serial1.inject(nameFrame, sizeof(nameFrame));
+    TEST_ASSERT_EQUAL(true, pack.update());
+    TEST_ASSERT_EQUAL_STRING("0123456789", pack.name);
+}
+
+// an unanswered name only times out the cycle, and a BMS that never answers it is only asked a few times
+void testBmsNameNotAnswered() {
+    PackBMS pack;
+    pack.begin(&Serial1);
+    for (uint8_t cycle = 0; cycle < NAME_QUERY_ATTEMPTS + 2; cycle++) {
+        Serial1.clear();
+        pack.poll();
+        TEST_ASSERT_EQUAL(cycle < NAME_QUERY_ATTEMPTS ? 21 : 14, Serial1.txLength());
+        Serial1.inject(basicInfoFrame, sizeof(basicInfoFrame));
+        Serial1.inject(voltagesFrame, sizeof(voltagesFrame));
+        TEST_ASSERT_EQUAL(cycle >= NAME_QUERY_ATTEMPTS, pack.update());
+        advanceMockMillis(5000);
+        TEST_ASSERT_EQUAL(cycle < NAME_QUERY_ATTEMPTS, pack.update());
+        TEST_ASSERT_EQUAL(false, pack.hasComError());
+        TEST_ASSERT_EQUAL(cycle + 1, pack.generation());
+    }
+}
+
+void testBmsPollTimeout() {
+    PackBMS pack;
+    pack.begin(&Serial1, 100);
+    pack.poll();
+    advanceMockMillis(50);
+    TEST_ASSERT_EQUAL(false, pack.update());
+    TEST_ASSERT_EQUAL(true, pack.isBusy());
+    advanceMockMillis(51);
+    TEST_ASSERT_EQUAL(false, pack.update());
+    TEST_ASSERT_EQUAL(true, pack.hasComError());
+    TEST_ASSERT_EQUAL(false, pack.isBusy());
+}
+
+static const uint32_t ntpEpoch = 3800000000UL;
+
+static void writeTimestamp(uint8_t *data, uint32_t seconds, uint16_t ms) {
+    uint32_t fraction = ((uint32_t) ms * 65536 + 999) / 1000 << 16;
+    for (uint8_t i = 0; i < 4; i++) {
+        data[i] = seconds >> (24 - 8 * i);
+        data[4 + i] = fraction >> (24 - 8 * i);
+    }
+}
+
+// the server received the request at seconds.ms and answered held ms later
+static void ntpReply(EthernetUDP &udp, uint32_t seconds, uint16_t ms, uint16_t held = 0) {
+    uint8_t packet[NTP_PACKET_SIZE] = {0x24};
+    writeTimestamp(packet + 32, seconds, ms);
+    writeTimestamp(packet + 40, seconds, ms + held);
+    udp.mockReply(packet, sizeof(packet));
+}
+
+void testNtpDoesNotBlock() {
+    EthernetUDP udp;
+    NtpClient ntp(udp, "pool.ntp.org", 0);
+    ntp.begin(8888);
+    ntp.update();
+    TEST_ASSERT_EQUAL(1, udp.packets);
+    TEST_ASSERT_EQUAL(NTP_PACKET_SIZE, udp.txLength);
+    TEST_ASSERT_EQUAL(0, millis());
+    ntp.update();
+    TEST_ASSERT_EQUAL(false, ntp.isSynced());
+
+    advanceMockMillis(40);
+    ntpReply(udp, ntpEpoch, 500, 10);
+    ntp.update();
+    TEST_ASSERT_EQUAL(true, ntp.isSynced());
+    TEST_ASSERT_EQUAL(30, ntp.roundTrip());
+
+    // 500 + 10 held + 15 on the way back, the clock is set at the next full second
+    advanceMockMillis(474);
+    ntp.update();
+    TEST_ASSERT_NOT_EQUAL((time_t) (ntpEpoch - NTP_UNIX_OFFSET + 1), now());
+    advanceMockMillis(1);
+    ntp.update();
+    TEST_ASSERT_EQUAL((time_t) (ntpEpoch - NTP_UNIX_OFFSET + 1), now());
+}
+
+void testNtpDriftWidensInterval() {
+    EthernetUDP udp;
+    NtpClient ntp(udp, "pool.ntp.org", 0);
+    ntp.begin(8888);
+    ntp.update();
+    ntpReply(udp, ntpEpoch, 0);
+    ntp.update();
+    TEST_ASSERT_EQUAL(NTP_MIN_INTERVAL, ntp.interval());
+
+    // the local clock loses 360 ms per hour, 100 ppm
+    for (uint8_t hour = 1; hour <= 2; hour++) {
+        advanceMockMillis(NTP_MIN_INTERVAL * 1000UL);
+        ntp.update();
+        TEST_ASSERT_EQUAL(hour + 1, udp.packets);
+        ntpReply(udp, ntpEpoch + hour * NTP_MIN_INTERVAL, hour * 360);
+        ntp.update();
+        TEST_ASSERT_EQUAL(100, ntp.drift());
+    }
+    TEST_ASSERT_EQUAL(2 * NTP_MIN_INTERVAL, ntp.interval());
+
+    // once set, the clock is corrected by a second every 10000 s
+    advanceMockMillis(1000);
+    ntp.update();
+    time_t synced = now();
+    advanceMockMillis(10000000UL);
+    ntp.update();
+    TEST_ASSERT_EQUAL(synced + 10001, now());
+}
+
+void testNtpRetriesLostReply() {
+    EthernetUDP udp;
+    NtpClient ntp(udp, "pool.ntp.org", 0);
+    ntp.begin(8888);
+    ntp.update();
+    advanceMockMillis(NTP_REPLY_TIMEOUT + 1);
+    ntp.update();
+    advanceMockMillis(NTP_RETRY_INTERVAL * 1000UL - 1);
+    ntp.update();
+    TEST_ASSERT_EQUAL(1, udp.packets);
+    advanceMockMillis(1);
+    ntp.update();
+    TEST_ASSERT_EQUAL(2, udp.packets);
+}
+
+static char taskTrace[16];
+
+static void traceA() {
+    strcat(taskTrace, "a");
+}
+
+static void traceB() {
+    strcat(taskTrace, "b");
+}
+
+void testSchedulerRunsEarliestDeadlineFirst() {
+    Scheduler scheduler;
+    taskTrace[0] = 0;
+    scheduler.add("a", traceA, 100, SKIP, 50);
+    scheduler.add("b", traceB, 30, SKIP);
+    scheduler.update();
+    TEST_ASSERT_EQUAL_STRING("b", taskTrace);
+    scheduler.update();
+    TEST_ASSERT_EQUAL_STRING("b", taskTrace);
+    advanceMockMillis(60);
+    scheduler.update();
+    TEST_ASSERT_EQUAL_STRING("bba", taskTrace);
+    TEST_ASSERT_EQUAL(2, scheduler[1].stats.runs);
+    TEST_ASSERT_EQUAL(30, scheduler[1].stats.maxLateness);
+}
+
+// a pass that overran two periods must not lose the work of either policy silently
+void testSchedulerPolicies() {
+    Scheduler scheduler;
+    taskTrace[0] = 0;
+    scheduler.add("catch up", traceA, 100, CATCH_UP, 100);
+    scheduler.add("skip", traceB, 100, SKIP, 100);
+    advanceMockMillis(350);
+    scheduler.update();
+    scheduler.update();
+    scheduler.update();
+    scheduler.update();
+    TEST_ASSERT_EQUAL_STRING("abaa", taskTrace);
+    TEST_ASSERT_EQUAL(2, scheduler[1].stats.skipped);
+
+    // both are back on their original phase
+    advanceMockMillis(49);
+    scheduler.update();
+    TEST_ASSERT_EQUAL_STRING("abaa", taskTrace);
+    advanceMockMillis(1);
+    scheduler.update();
+    TEST_ASSERT_EQUAL_STRING("abaaab", taskTrace);
+}
+
+void testSchedulerDefer() {
+    Scheduler scheduler;
+    taskTrace[0] = 0;
+    int8_t task = scheduler.add("a", traceA, 100, SKIP);
+    scheduler.defer(task, 500);
+    advanceMockMillis(499);
+    scheduler.update();
+    TEST_ASSERT_EQUAL_STRING("", taskTrace);
+    advanceMockMillis(1);
+    scheduler.update();
+    TEST_ASSERT_EQUAL_STRING("a", taskTrace);
+}
+
+void testSensorTiers() {
+    SensorTier<4, 3600UL> tier;
+    // 1600002000 starts an hour
+    tier.add({1600001100, 101325, 2050, 4500});
+    tier.add({1600002000, 101301, 1990, 4520});
+    tier.add({1600002900, 101340, 2110, 4470});
+    TEST_ASSERT_EQUAL(1, tier.size());
+    TEST_ASSERT_EQUAL(1, tier[0].count);
+    TEST_ASSERT_EQUAL(1600002000 - 3600, tier.time(0));
+    TEST_ASSERT_EQUAL(2, tier.current().count);
+
+    SensorRange range = decodeAggregate(tier[0], tier.time(0));
+    TEST_ASSERT_EQUAL(101326, range.avg[SENSOR_PRESSURE]);
+    TEST_ASSERT_TRUE(range.min[SENSOR_PRESSURE] <= 101325 && range.max[SENSOR_PRESSURE] >= 101325);
+    TEST_ASSERT_EQUAL(2050, range.avg[SENSOR_TEMPERATURE]);
+    TEST_ASSERT_EQUAL(4500, range.avg[SENSOR_HUMIDITY]);
+
+    // min and max cover the records after the round trip
+    range = summaryRange(tier.current());
+    TEST_ASSERT_EQUAL(1990, range.min[SENSOR_TEMPERATURE]);
+    TEST_ASSERT_EQUAL(2050, range.avg[SENSOR_TEMPERATURE]);
+    tier.add({1600009200, 101000, 1500, 5000}); // two hours later, one hour without records
+    tier.add({1600012800, 101000, 1500, 5000});
+    TEST_ASSERT_EQUAL(4, tier.size());
+    TEST_ASSERT_EQUAL(1, tier[3].count);
+    range = decodeAggregate(tier[1], tier.time(1));
+    TEST_ASSERT_TRUE(range.min[SENSOR_TEMPERATURE] <= 1990 && range.max[SENSOR_TEMPERATURE] >= 2110);
+    TEST_ASSERT_TRUE(range.min[SENSOR_PRESSURE] <= 101301 && range.max[SENSOR_PRESSURE] >= 101340);
+    TEST_ASSERT_TRUE(range.min[SENSOR_HUMIDITY] <= 4470 && range.max[SENSOR_HUMIDITY] >= 4520);
+    TEST_ASSERT_EQUAL(0, tier[2].count);
+    TEST_ASSERT_EQUAL(tier.time(1) + 3600, tier.time(2));
+    TEST_ASSERT_EQUAL(2, tier.after(tier.time(1)));
+
+    hourlySensorData.clear();
+    hourlySensorData.add({1600001100, 101325, 2050, 4500});
+    hourlySensorData.add({1600002000, 101301, 1990, 4520});
+    mockSocketReset(socket);
+    printWebPage(EthernetClient(&socket), "/sensors.json", GET, 0, "res=hour");
+    TEST_ASSERT_NOT_NULL(strstr(response(), R"===("temp":20.50, "tempMin":20.50, "tempMax":20.50)==="));
+    TEST_ASSERT_NOT_NULL(strstr(response(), R"===("temp":19.90, "tempMin":19.90, "tempMax":19.90)==="));
+    mockSocketReset(socket);
+    printWebPage(EthernetClient(&socket), "/sensors.json", GET, 0, "res=hour&since=1599998400");
+    TEST_ASSERT_NULL(strstr(response(), R"===("temp":20.50)==="));
+    TEST_ASSERT_NOT_NULL(strstr(response(), R"===("temp":19.90)==="));
+    hourlySensorData.clear();
+}
+
+void testSlidingMax() {
+    SlidingMax<4, 1000> window;
+    int16_t value;
+    TEST_ASSERT_FALSE(window.get(value, millis()));
+    window.add(5, millis());
+    advanceMockMillis(1000);
+    window.add(9, millis());
+    window.add(3, millis());
+    advanceMockMillis(1000);
+    window.add(7, millis());
+    TEST_ASSERT_TRUE(window.get(value, millis()));
+    TEST_ASSERT_EQUAL(9, value);
+    // the bucket holding 9 leaves the window three buckets later, 7 is the next newer maximum
+    advanceMockMillis(3000);
+    TEST_ASSERT_TRUE(window.get(value, millis()));
+    TEST_ASSERT_EQUAL(7, value);
+    advanceMockMillis(1000);
+    TEST_ASSERT_FALSE(window.get(value, millis()));
+    // a long pause empties the window at once
+    window.add(-2, millis());
+    advanceMockMillis(60000);
+    window.add(-4, millis());
+    TEST_ASSERT_TRUE(window.get(value, millis()));
+    TEST_ASSERT_EQUAL(-4, value);
+}
+
+void testTrailing24hExtremes() {
+    PackBMS pack;
+    TEST_ASSERT_EQUAL_FLOAT(0, pack.maxVoltage24());
+    pack.add24Sample(13.2f, -3.5f);
+    advanceMockMillis(12 * 3600000UL);
+    pack.add24Sample(13.6f, 2.25f);
+    TEST_ASSERT_EQUAL_FLOAT(13.2f, pack.minVoltage24());
+    TEST_ASSERT_EQUAL_FLOAT(13.6f, pack.maxVoltage24());
+    TEST_ASSERT_EQUAL_FLOAT(2.25f, pack.maxCharge24());
+    TEST_ASSERT_EQUAL_FLOAT(3.5f, pack.maxDischarge24());
+    // no cliff at any time of day, the first sample just ages out after 24 h
+    advanceMockMillis(12 * 3600000UL);
+    TEST_ASSERT_EQUAL_FLOAT(13.6f, pack.minVoltage24());
+    TEST_ASSERT_EQUAL_FLOAT(0, pack.maxDischarge24());
+    TEST_ASSERT_EQUAL_FLOAT(2.25f, pack.maxCharge24());
+}
+
+void testEnergyCounter() {
+    EnergyCounter counter;
+    // 10 A at 13 V for an hour, polled every 10 minutes
+    for (uint32_t i = 0; i <= 6; i++) {
+        counter.add(13.0f, 10.0f, i * 600000UL);
+    }
+    TEST_ASSERT_EQUAL(1000, counter.charged());
+    TEST_ASSERT_EQUAL(1300, counter.chargedWh());
+    // from 10 A charge to 4 A discharge over 10 minutes, split where the current crosses zero after 10/14 of it
+    counter.add(13.0f, -4.0f, 4200000UL);
+    TEST_ASSERT_EQUAL(1000 + 59, counter.charged());
+    TEST_ASSERT_EQUAL(9, counter.discharged());
+    TEST_ASSERT_EQUAL(12, counter.dischargedWh());
+    // a gap longer than ENERGY_MAX_GAP is not integrated
+    counter.add(13.0f, -4.0f, 4200000UL + ENERGY_MAX_GAP + 1);
+    TEST_ASSERT_EQUAL(9, counter.discharged());
+
+    counter.rollover(1600041600);
+    TEST_ASSERT_EQUAL(0, counter.charged());
+    TEST_ASSERT_EQUAL(1, counter.days());
+    TEST_ASSERT_EQUAL(1059, counter[0].charged);
+    TEST_ASSERT_EQUAL(138, counter[0].chargedWh);
+
+    energy = counter;
+    mockSocketReset(socket);
+    printWebPage(EthernetClient(&socket), "/battery.json", GET);
+    TEST_ASSERT_NOT_NULL(strstr(response(), R"===("chargedAh": 0.00, "dischargedAh": 0.00, "chargedWh": 0.0, "dischargedWh": 0.0,)==="));
+    TEST_ASSERT_NOT_NULL(strstr(response(), R"===({"day": "2020-09-14", "chargedAh": 10.59, "dischargedAh": 0.09, "chargedWh": 138, "dischargedWh": 1})==="));
+    energy = EnergyCounter();
+}
+
+void testFaultCounting() {
+    PackBMS &bms = battery[0];
+    uint8_t frame[sizeof(basicInfoFrame)];
+    memcpy(frame, basicInfoFrame, sizeof(frame));
+    bms.clearFaultCounts();
+    bms.protectionStatus = 0;
+    frame[21] = 0x05; // cell over-voltage and pack over-voltage
+    bms.parseBasicInfoResponse(frame);
+    bms.parseBasicInfoResponse(frame);
+    frame[20] = 0x04; // short circuit rises, pack over-voltage stays, cell over-voltage clears
+    frame[21] = 0x04;
+    bms.parseBasicInfoResponse(frame);
+    frame[20] = 0x00;
+    frame[21] = 0x01;
+    bms.parseBasicInfoResponse(frame);
+    TEST_ASSERT_EQUAL(2, bms.faultCounts[FAULT_CELL_OVERVOLTAGE]);
+    TEST_ASSERT_EQUAL(1, bms.faultCounts[FAULT_PACK_OVERVOLTAGE]);
+    TEST_ASSERT_EQUAL(1, bms.faultCounts[FAULT_SHORT_CIRCUIT]);
+    TEST_ASSERT_EQUAL(0, bms.faultCounts[FAULT_SOFTWARE_LOCK_MOS]);
+    TEST_ASSERT_TRUE(bms.protectionStatus.isSet(FAULT_CELL_OVERVOLTAGE));
+    TEST_ASSERT_FALSE(bms.protectionStatus.isSet(FAULT_SHORT_CIRCUIT));
+
+    mockSocketReset(socket);
+    printWebPage(EthernetClient(&socket), "/battery.json", GET);
+    TEST_ASSERT_NOT_NULL(strstr(response(), R"===({"fault": "Single Cell Over-Voltage", "count": 2},)==="));
+    TEST_ASSERT_NOT_NULL(strstr(response(), R"===({"fault": "Short Circuit", "count": 1},)==="));
+    TEST_ASSERT_NOT_NULL(strstr(response(), R"===({"fault": "Software Lock Mos", "count": 0})==="));
+    bms.clearFaultCounts();
+    bms.protectionStatus = 0;
+}
+
+void testFaultJournal() {
+    faultJournal.clear();
+    faultJournal.update(ProtectionStatus(1u << FAULT_SHORT_CIRCUIT), 13.2f, -1.05f, 1000);
+    faultJournal.update(ProtectionStatus(1u << FAULT_SHORT_CIRCUIT), 13.2f, 0, 1030);
+    faultJournal.update(ProtectionStatus(1u << FAULT_CHARGE_OVER_TEMPERATURE), 13.5f, 2.0f, 1060);
+    TEST_ASSERT_EQUAL(3, faultJournal.size());
+    TEST_ASSERT_EQUAL(FAULT_SHORT_CIRCUIT | FAULT_EVENT_ACTIVE, faultJournal[0].fault);
+    TEST_ASSERT_EQUAL(-105, faultJournal[0].current);
+    TEST_ASSERT_EQUAL(1, faultJournal.after(1030));
+
+    mockSocketReset(socket);
+    printWebPage(EthernetClient(&socket), "/faults.json", GET);
+    TEST_ASSERT_NOT_NULL(strstr(response(), R"===({ "newest": 1060, "events":[)==="));
+    TEST_ASSERT_NOT_NULL(strstr(response(), R"===({"time": 1000, "fault": "Short Circuit", "active": true, "voltage": 13.20, "current": -1.05},)==="));
+
+    mockSocketReset(socket);
+    printWebPage(EthernetClient(&socket), "/faults.json", GET, 0, "since=1000");
+    TEST_ASSERT_NULL(strstr(response(), R"===("time": 1000)==="));
+    TEST_ASSERT_NOT_NULL(strstr(response(), R"===({"time": 1060, "fault": "Charging Over Temperature", "active": true, "voltage": 13.50, "current": 2.00},)==="));
+    TEST_ASSERT_NOT_NULL(strstr(response(), "{\"time\": 1060, \"fault\": \"Short Circuit\", \"active\": false, \"voltage\": 13.50, \"current\": 2.00}\r\n]}"));
+    faultJournal.clear();
+    faultJournal.update(ProtectionStatus(), 0, 0, 0);
+}
+
+// every fault with the widest numbers, the longest names fill most of the line buffer
+void testFaultJournalEveryFault() {
+    faultJournal.clear();
+    faultJournal.update(ProtectionStatus(FAULT_MASK), 327.67f, -327.67f, 4294967295UL);
+    TEST_ASSERT_EQUAL(NUM_FAULTS, faultJournal.size());
+
+    mockSocketReset(socket);
+    printWebPage(EthernetClient(&socket), "/faults.json", GET);
+    char name[FAULT_NAME_SIZE];
+    char expected[160];
+    for (uint8_t i = 0; i < NUM_FAULTS; i++) {
+        sprintf(expected, R"===({"time": 4294967295, "fault": "%s", "active": true, "voltage": 327.67, "current": -327.67}%s)===",
+                strcpy_P(name, faultName(i)), i != NUM_FAULTS - 1 ? "," : "");
+        TEST_ASSERT_NOT_NULL(strstr(response(), expected));
+    }
+    faultJournal.clear();
+    faultJournal.update(ProtectionStatus(), 0, 0, 0);
+}
+
+void testPersistenceRestoresNewestCheckpoint() {
+    mockEepromErase();
+    PersistentState state{};
+    TEST_ASSERT_FALSE(Persistence().restore(state));
+
+    Persistence persistence;
+    for (uint8_t i = 0; i < 20; i++) {
+        state.packs[1].faultCounts[FAULT_SHORT_CIRCUIT] = i;
+        state.packs[1].maxCharge24 = i * 0.5f;
+        state.relays = i & 0x0Fu;
+        TEST_ASSERT_TRUE(persistence.save(state));
+    }
+    TEST_ASSERT_FALSE(persistence.save(state));
+
+    // a fresh instance stands in for a reset
+    PersistentState restored{};
+    TEST_ASSERT_TRUE(Persistence().restore(restored));
+    TEST_ASSERT_EQUAL(19, restored.packs[1].faultCounts[FAULT_SHORT_CIRCUIT]);
+    TEST_ASSERT_EQUAL_FLOAT(9.5f, restored.packs[1].maxCharge24);
+    TEST_ASSERT_EQUAL(3, restored.relays);
+
+    // the checkpoints went round the slots
+    uint8_t slots = persistence.slotCount();
+    TEST_ASSERT_EQUAL(MOCK_EEPROM_SIZE / sizeof(PersistSlot), slots);
+    for (uint8_t slot = 0; slot < slots; slot++) {
+        uint32_t writes = mockEepromWrites(slot * sizeof(PersistSlot) + offsetof(PersistSlot, sequence));
+        TEST_ASSERT_TRUE(writes == 20u / slots || writes == 20u / slots + 1);
+    }
+}
+
+void testPersistenceSurvivesTornWrite() {
+    mockEepromErase();
+    Persistence persistence;
+    PersistentState state{};
+    state.packs[0].minVoltage24 = 12.5f;
+    persistence.save(state);
+    state.packs[0].minVoltage24 = 12.25f;
+    persistence.save(state);
+    // reset in the middle of the second checkpoint
+    EEPROM.write(sizeof(PersistSlot) + offsetof(PersistSlot, state), 0x55);
+
+    PersistentState restored{};
+    TEST_ASSERT_TRUE(Persistence().restore(restored));
+    TEST_ASSERT_EQUAL_FLOAT(12.5f, restored.packs[0].minVoltage24);
+}
+
+void testAdaptivePolling() {
+    AdaptivePoller poller;
+    PackBMS pack;
+    pack.current = 5;
+    pack.totalVoltage = 13.2f;
+    TEST_ASSERT_EQUAL(BMS_POLL_INTERVAL, poller.update(pack));
+    // a step in current is polled fast, then backs off to the steady interval
+    advanceMockMillis(1000);
+    pack.current = 15;
+    TEST_ASSERT_EQUAL(BMS_POLL_MIN_INTERVAL, poller.update(pack));
+    for (int i = 0; i < 10; i++) {
+        advanceMockMillis(poller.interval());
+        poller.update(pack);
+    }
+    TEST_ASSERT_EQUAL(BMS_POLL_INTERVAL, poller.interval());
+    // an idle pack backs off to the maximum
+    pack.current = 0;
+    advanceMockMillis(60000);
+    for (int i = 0; i < 10; i++) {
+        advanceMockMillis(poller.interval());
+        poller.update(pack);
+    }
+    TEST_ASSERT_EQUAL(BMS_POLL_MAX_INTERVAL, poller.interval());
+    TEST_ASSERT_EQUAL(BMS_POLL_MAX_INTERVAL, poller.update(pack));
+    // any protection bit polls fast
+    pack.protectionStatus = 1u << FAULT_SHORT_CIRCUIT;
+    advanceMockMillis(poller.interval());
+    TEST_ASSERT_EQUAL(BMS_POLL_MIN_INTERVAL, poller.update(pack));
+}
+
+// a step between two slow cycles is as much a change as a fast slope
+void testAdaptivePollingSteps() {
+    AdaptivePoller poller;
+    poller.update(5, 13.2f, false);
+    advanceMockMillis(BMS_POLL_INTERVAL);
+    TEST_ASSERT_EQUAL(BMS_POLL_INTERVAL, poller.update(5.5f, 13.25f, false));
+    // 3 A in 30 s is a slope of only 0.1 A/s
+    advanceMockMillis(BMS_POLL_INTERVAL);
+    TEST_ASSERT_EQUAL(BMS_POLL_MIN_INTERVAL, poller.update(8.5f, 13.25f, false));
+
+    for (int i = 0; i < 10; i++) {
+        advanceMockMillis(poller.interval());
+        poller.update(0, 13.25f, false);
+    }
+    TEST_ASSERT_EQUAL(BMS_POLL_MAX_INTERVAL, poller.interval());
+    // 0.3 V in 300 s while idle, and a load coming on
+    advanceMockMillis(BMS_POLL_MAX_INTERVAL);
+    TEST_ASSERT_EQUAL(BMS_POLL_MIN_INTERVAL, poller.update(0, 12.95f, false));
+    for (int i = 0; i < 10; i++) {
+        advanceMockMillis(poller.interval());
+        poller.update(0, 12.95f, false);
+    }
+    advanceMockMillis(BMS_POLL_MAX_INTERVAL);
+    TEST_ASSERT_EQUAL(BMS_POLL_MIN_INTERVAL, poller.update(-4, 12.95f, false));
+}
+
+// basic info frame with another current (0.01 A) and state of charge
+static void basicInfoWith(uint8_t *frame, int16_t current, uint8_t stateOfCharge) {
+    memcpy(frame, basicInfoFrame, sizeof(basicInfoFrame));
+    frame[6] = (uint16_t) current >> 8u;
+    frame[7] = (uint16_t) current & 0xFFu;
+    frame[23] = stateOfCharge;
+    uint16_t checksum = BmsCore::calculateChecksum(&frame[2], sizeof(basicInfoFrame) - 5);
+    frame[sizeof(basicInfoFrame) - 3] = checksum >> 8u;
+    frame[sizeof(basicInfoFrame) - 2] = checksum & 0xFFu;
+}
+
+// packs on their own ports are polled at the same time
+void testPackBankSeparatePorts() {
+    PackBank<PackBMS, 2> bank;
+    bank.begin(0, &Serial1);
+    bank.begin(1, &Serial2);
+    strcpy(bank[0].name, "known");
+    strcpy(bank[1].name, "known");
+    bank.poll();
+    TEST_ASSERT_EQUAL(14, Serial1.txLength());
+    TEST_ASSERT_EQUAL(14, Serial2.txLength());
+
+    uint8_t frame[sizeof(basicInfoFrame)];
+    basicInfoWith(frame, 500, 72);
+    Serial1.inject(frame, sizeof(frame));
+    Serial1.inject(voltagesFrame, sizeof(voltagesFrame));
+    TEST_ASSERT_FALSE(bank.update());
+    basicInfoWith(frame, -200, 48);
+    Serial2.inject(frame, sizeof(frame));
+    Serial2.inject(voltagesFrame, sizeof(voltagesFrame));
+    TEST_ASSERT_TRUE(bank.update());
+    TEST_ASSERT_FALSE(bank.update());
+
+    TEST_ASSERT_EQUAL_FLOAT(3.0f, bank.current());
+    TEST_ASSERT_EQUAL_FLOAT(58.88f, bank.totalVoltage());
+    TEST_ASSERT_EQUAL(48, bank.stateOfCharge());
+    uint8_t pack, cell;
+    TEST_ASSERT_EQUAL_FLOAT(3.895f, bank.worstCellVoltage(pack, cell));
+    TEST_ASSERT_EQUAL(0, pack);
+    TEST_ASSERT_EQUAL(6, cell);
+}
+
+static uint8_t selectedPacks[4];
+static uint8_t selections;
+
+static void recordSelection(uint8_t pack) {
+    selectedPacks[selections++ % 4] = pack;
+}
+
+// packs on a shared port take turns, and the next cycle starts with the other pack
+void testPackBankSharedPort() {
+    PackBank<PackBMS, 2> bank;
+    selections = 0;
+    bank.setSelector(recordSelection);
+    bank.begin(0, &Serial1);
+    bank.begin(1, &Serial1);
+    strcpy(bank[0].name, "known");
+    strcpy(bank[1].name, "known");
+    bank.poll();
+    TEST_ASSERT_EQUAL(14, Serial1.txLength());
+    TEST_ASSERT_EQUAL(1, selections);
+    TEST_ASSERT_EQUAL(0, selectedPacks[0]);
+
+    Serial1.inject(basicInfoFrame, sizeof(basicInfoFrame));
+    Serial1.inject(voltagesFrame, sizeof(voltagesFrame));
+    TEST_ASSERT_FALSE(bank.update());
+    TEST_ASSERT_EQUAL(28, Serial1.txLength());
+    TEST_ASSERT_EQUAL(1, selectedPacks[1]);
+    TEST_ASSERT_TRUE(bank.isOnline(0));
+    TEST_ASSERT_FALSE(bank.isOnline(1));
+
+    Serial1.inject(basicInfoFrame, sizeof(basicInfoFrame));
+    Serial1.inject(voltagesFrame, sizeof(voltagesFrame));
+    TEST_ASSERT_TRUE(bank.update());
+    TEST_ASSERT_TRUE(bank.isOnline(1));
+
+    bank.poll();
+    TEST_ASSERT_EQUAL(1, selectedPacks[2]);
+}
+
+// the name reply of one pack is in before the bus switches to the next
+void testPackBankSharedPortNames() {
+    PackBank<PackBMS, 2> bank;
+    selections = 0;
+    bank.setSelector(recordSelection);
+    bank.begin(0, &Serial1);
+    bank.begin(1, &Serial1);
+    bank.poll();
+    TEST_ASSERT_EQUAL(21, Serial1.txLength());
+
+    Serial1.inject(basicInfoFrame, sizeof(basicInfoFrame));
+    Serial1.inject(voltagesFrame, sizeof(voltagesFrame));
+    TEST_ASSERT_FALSE(bank.update());
+    TEST_ASSERT_EQUAL(21, Serial1.txLength());
+    TEST_ASSERT_EQUAL(1, selections);
+    Serial1.inject(nameFrame, sizeof(nameFrame));
+    TEST_ASSERT_FALSE(bank.update());
+    TEST_ASSERT_EQUAL(42, Serial1.txLength());
+    TEST_ASSERT_EQUAL(1, selectedPacks[1]);
+
+    Serial1.inject(basicInfoFrame, sizeof(basicInfoFrame));
+    Serial1.inject(voltagesFrame, sizeof(voltagesFrame));
+    Serial1.inject(nameFrame, sizeof(nameFrame));
+    TEST_ASSERT_TRUE(bank.update());
+    TEST_ASSERT_TRUE(bank.isOnline(0));
+    TEST_ASSERT_TRUE(bank.isOnline(1));
+    TEST_ASSERT_EQUAL_STRING("0123456789", bank[0].name);
+    TEST_ASSERT_EQUAL_STRING("0123456789", bank[1].name);
+}
+
+// a cycle where no pack answers completes with the bank offline
+void testPackBankOffline() {
+    PackBank<PackBMS, 2> bank;
+    bank.begin(0, &Serial1);
+    bank.begin(1, &Serial2);
+    strcpy(bank[0].name, "known");
+    strcpy(bank[1].name, "known");
+    TEST_ASSERT_FALSE(bank.anyOnline());
+    bank.poll();
+    Serial1.inject(basicInfoFrame, sizeof(basicInfoFrame));
+    Serial1.inject(voltagesFrame, sizeof(voltagesFrame));
+    TEST_ASSERT_FALSE(bank.update());
+    TEST_ASSERT_TRUE(bank.anyOnline());
+    advanceMockMillis(2001);
+    TEST_ASSERT_TRUE(bank.update());
+    TEST_ASSERT_TRUE(bank.anyOnline());
+    uint32_t generation = bank.generation();
+
+    bank.poll();
+    TEST_ASSERT_FALSE(bank.update());
+    advanceMockMillis(2001);
+    TEST_ASSERT_TRUE(bank.update());
+    // no pack completed a cycle, yet the bank reads differently
+    TEST_ASSERT_TRUE(bank.generation() != generation);
+    TEST_ASSERT_FALSE(bank.isOnline(0));
+    TEST_ASSERT_FALSE(bank.isOnline(1));
+    TEST_ASSERT_FALSE(bank.anyOnline());
+    TEST_ASSERT_EQUAL_FLOAT(0, bank.current());
+    TEST_ASSERT_EQUAL_FLOAT(0, bank.totalVoltage());
+}
+
+void testBatteryPackDetail() {
+    battery[1].stateOfCharge = 55;
+    mockSocketReset(socket);
+    printWebPage(EthernetClient(&socket), "/battery.json", GET, 0, "pack=1");
+    TEST_ASSERT_NOT_NULL(strstr(response(), R"===("remainingSOC": 55,)==="));
+    TEST_ASSERT_NOT_NULL(strstr(response(), R"===({"cell":"7", "cellVoltage":)==="));
+    TEST_ASSERT_NOT_NULL(strstr(response(), R"===("pack": 1, "online": false)==="));
+
+    // the bank leaves out packs that never answered
+    mockSocketReset(socket);
+    printWebPage(EthernetClient(&socket), "/battery.json", GET);
+    TEST_ASSERT_NOT_NULL(strstr(response(), R"===("remainingSOC": 0,)==="));
+    TEST_ASSERT_NOT_NULL(strstr(response(), R"===({"cell":"1.7", "cellVoltage":)==="));
+    TEST_ASSERT_NOT_NULL(strstr(response(), R"===("packs": 2, "packsOnline": 0,)==="));
+    TEST_ASSERT_NOT_NULL(strstr(response(), R"===("worstCellPack": 0, "worstCellNumber": 0,)==="));
+
+    mockSocketReset(socket);
+    printWebPage(EthernetClient(&socket), "/battery.json", GET, 0, "pack=2");
+    TEST_ASSERT_NOT_NULL(strstr(response(), "\r\n\r\n{}\r\n"));
+    battery[1].stateOfCharge = 0;
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(testParseGetRequest);
+    RUN_TEST(testParsePostRequest);
+    RUN_TEST(testParsePostWithoutPort);
+    RUN_TEST(testParseUnsupportedRequest);
+    RUN_TEST(testParseLongUrl);
+    RUN_TEST(testParseSplitRequest);
+    RUN_TEST(testParseTimeout);
+    RUN_TEST(testParseReadBudget);
+    RUN_TEST(testConnectionsAreInterleaved);
+    RUN_TEST(testConnectionTableFull);
+    RUN_TEST(testRequestPathDoesNotAllocate);
+    RUN_TEST(testParseIfNoneMatch);
+    RUN_TEST(testConditionalGet);
+    RUN_TEST(testTimingHistogram);
+    RUN_TEST(testTimingJson);
+    RUN_TEST(testFormatNumbers);
+    RUN_TEST(testSwitchesJson);
+    RUN_TEST(testRelayCycleDoesNotBlock);
+    RUN_TEST(testRelaySetCancelsCycle);
+    RUN_TEST(testResponseIsCoalesced);
+    RUN_TEST(testPostRedirect);
+    RUN_TEST(testRingBufferOrder);
+    RUN_TEST(testRingBufferPartial);
+    RUN_TEST(testSensorsJsonSkipsEmptySlots);
+    RUN_TEST(testParseQuery);
+    RUN_TEST(testSensorsJsonSince);
+    RUN_TEST(testSensorsJsonDownsampled);
+    RUN_TEST(testSensorHistoryAfter);
+    RUN_TEST(testSensorHistoryRoundTrip);
+    RUN_TEST(testSensorHistoryEviction);
+    RUN_TEST(testSensorHistoryJumps);
+    RUN_TEST(testSensorHistoryBlockEviction);
+    RUN_TEST(testBmsPollCycle);
+    RUN_TEST(testBmsPackSize);
+    RUN_TEST(testBmsOversizeFrames);
+    RUN_TEST(testBasicInfoTooShort);
+    RUN_TEST(testBasicInfoLayout);
+    RUN_TEST(testBmsPipelinedResponsesOutOfOrder);
+    RUN_TEST(testBmsSequentialPoll);
+    RUN_TEST(testBmsNameNotAnswered);
+    RUN_TEST(testBmsPollTimeout);
+    RUN_TEST(testNtpDoesNotBlock);
+    RUN_TEST(testNtpDriftWidensInterval);
+    RUN_TEST(testNtpRetriesLostReply);
+    RUN_TEST(testSchedulerRunsEarliestDeadlineFirst);
+    RUN_TEST(testSchedulerPolicies);
+    RUN_TEST(testSchedulerDefer);
+    RUN_TEST(testSensorTiers);
+    RUN_TEST(testSlidingMax);
+    RUN_TEST(testTrailing24hExtremes);
+    RUN_TEST(testEnergyCounter);
+    RUN_TEST(testFaultCounting);
+    RUN_TEST(testFaultJournal);
+    RUN_TEST(testFaultJournalEveryFault);
+    RUN_TEST(testPersistenceRestoresNewestCheckpoint);
+    RUN_TEST(testPersistenceSurvivesTornWrite);
+    RUN_TEST(testAdaptivePolling);
+    RUN_TEST(testAdaptivePollingSteps);
+    RUN_TEST(testPackBankSeparatePorts);
+    RUN_TEST(testPackBankSharedPort);
+    RUN_TEST(testPackBankSharedPortNames);
+    RUN_TEST(testPackBankOffline);
+    RUN_TEST(testBatteryPackDetail);
+    return UNITY_END();
+}
+
+#endif